@@ -5,6 +5,7 @@
 */
 
 #include "browser.h"
+#include "contentregistry.h"
 
 #include <KActionCollection>
 #include <KColorScheme>
@@ -24,13 +25,10 @@
 
 #include <QKeyEvent>
 
-int Browser::m_availableBrowserId = 0;
-
 Browser::Browser(QWidget *parent)
     : QObject(nullptr)
 {
-    m_browserId = m_availableBrowserId;
-    m_availableBrowserId++;
+    m_browserId = ContentRegistry::self()->allocateId();
     m_parentSplitter = parent;
 
     KPluginMetaData part(QStringLiteral("kf6/parts/webenginepart"));
@@ -91,6 +89,9 @@ Browser::Browser(QWidget *parent)
 Browser::~Browser()
 {
     m_destroying = true;
+
+    ContentRegistry::self()->remove(m_browserId);
+
     if (m_part) {
         delete m_part;
     }
@@ -167,6 +168,9 @@ void Browser::displayKPartLoadError()
 
 void Browser::setTitle(const QString &title)
 {
+    if (title == m_title)
+        return;
+
     m_title = title;
 
     Q_EMIT titleChanged(m_browserId, m_title);
@@ -87,7 +87,6 @@ private Q_SLOTS:
 private:
     void displayKPartLoadError();
 
-    static int m_availableBrowserId;
     int m_browserId;
 
     KParts::Part *m_part = nullptr;
@@ -95,7 +94,7 @@ private:
     QPointer<QWidget> m_browserWidget = nullptr;
     QWidget *m_parentSplitter;
     QVBoxLayout *m_layout;
-    QLineEdit *m_urlBar;
+    QLineEdit *m_urlBar = nullptr;
 
     QString m_title;
 
@@ -6,20 +6,23 @@
 
 #include "appearancesettings.h"
 #include "settings.h"
+#include "skininstalljob.h"
 #include "skinlistdelegate.h"
+#include "skinpackage.h"
+#include "skinscanner.h"
 
 #include <KIO/CopyJob>
 #include <KIO/DeleteJob>
-#include <KIO/ListJob>
+#include <KIO/JobTracker>
 #include <KJobUiDelegate>
 #include <KLocalizedString>
 #include <KMessageBox>
-#include <KTar>
 
 #include <QDir>
-#include <QDirIterator>
 #include <QFile>
 #include <QFileDialog>
+#include <QFileInfo>
+#include <QMimeDatabase>
 #include <QPointer>
 #include <QStandardItemModel>
 
@@ -40,6 +43,10 @@ AppearanceSettings::AppearanceSettings(QWidget *parent)
     skinList->setModel(m_skins);
     skinList->setItemDelegate(m_skinListDelegate);
 
+    m_skinScanner = new SkinScanner(this);
+    connect(m_skinScanner, &SkinScanner::skinFound, this, &AppearanceSettings::addSkinItem);
+    connect(m_skinScanner, &SkinScanner::finished, this, &AppearanceSettings::skinListPopulated);
+
     connect(skinList->selectionModel(), &QItemSelectionModel::currentChanged, this, &AppearanceSettings::updateSkinSetting);
     connect(skinList->selectionModel(), &QItemSelectionModel::currentChanged, this, &AppearanceSettings::updateRemoveSkinButton);
     connect(installButton, SIGNAL(clicked()), this, SLOT(installSkin()));
@@ -70,9 +77,6 @@ void AppearanceSettings::showEvent(QShowEvent *event)
 {
     populateSkinList();
 
-    if (skinList->currentIndex().isValid())
-        skinList->scrollTo(skinList->currentIndex());
-
     QWidget::showEvent(event);
 }
 
@@ -82,84 +86,59 @@ void AppearanceSettings::populateSkinList()
 
     QStringList allSkinLocations;
     allSkinLocations << QStandardPaths::locateAll(QStandardPaths::GenericDataLocation, QStringLiteral("/yakuake/skins/"), QStandardPaths::LocateDirectory);
+    allSkinLocations << QStringLiteral(":/yakuake/skins");
     allSkinLocations << QStandardPaths::locateAll(QStandardPaths::GenericDataLocation, QStringLiteral("/yakuake/kns_skins/"), QStandardPaths::LocateDirectory);
 
-    for (const QString &skinLocation : std::as_const(allSkinLocations)) {
-        populateSkinList(skinLocation);
-    }
-
-    m_skins->sort(0);
+    m_skinScanner->scan(allSkinLocations, m_knsSkinDir);
 
     updateRemoveSkinButton();
 }
 
-void AppearanceSettings::populateSkinList(const QString &installLocation)
+void AppearanceSettings::addSkinItem(const SkinInfo &skin)
 {
-    QDirIterator it(installLocation, QDir::Dirs | QDir::NoDotAndDotDot);
+    QStandardItem *item = createSkinItem(skin);
 
-    while (it.hasNext()) {
-        const QDir &skinDir(it.next());
+    m_skins->appendRow(item);
 
-        if (skinDir.exists(QStringLiteral("title.skin")) && skinDir.exists(QStringLiteral("tabs.skin"))) {
-            QStandardItem *skin = createSkinItem(skinDir.absolutePath());
+    if (skin.id == m_selectedSkinId)
+        skinList->setCurrentIndex(item->index());
 
-            if (!skin)
-                continue;
+    updateRemoveSkinButton();
+}
 
-            m_skins->appendRow(skin);
+void AppearanceSettings::skinListPopulated()
+{
+    m_skins->sort(0);
 
-            if (skin->data(SkinId).toString() == m_selectedSkinId)
-                skinList->setCurrentIndex(skin->index());
-        }
-    }
+    if (skinList->currentIndex().isValid())
+        skinList->scrollTo(skinList->currentIndex());
 }
 
-QStandardItem *AppearanceSettings::createSkinItem(const QString &skinDir)
+QStandardItem *AppearanceSettings::createSkinItem(const SkinInfo &skin)
 {
-    QString skinId = skinDir.section(QLatin1Char('/'), -1, -1);
-    QString titleName, tabName, skinName;
-    QString titleAuthor, tabAuthor, skinAuthor;
-    QString titleIcon, tabIcon;
+    QString skinName = skin.name;
+    QString skinAuthor = skin.author;
     QIcon skinIcon;
 
-    // Check if the skin dir starts with the path where all
-    // KNS3 skins are found in.
-    bool isKnsSkin = skinDir.startsWith(m_knsSkinDir);
-
-    KConfig titleConfig(skinDir + QStringLiteral("/title.skin"), KConfig::SimpleConfig);
-    KConfigGroup titleDescription = titleConfig.group(QStringLiteral("Description"));
-
-    KConfig tabConfig(skinDir + QStringLiteral("/tabs.skin"), KConfig::SimpleConfig);
-    KConfigGroup tabDescription = tabConfig.group(QStringLiteral("Description"));
-
-    titleName = titleDescription.readEntry("Skin", "");
-    titleAuthor = titleDescription.readEntry("Author", "");
-    titleIcon = skinDir + titleDescription.readEntry("Icon", "");
-
-    tabName = tabDescription.readEntry("Skin", "");
-    tabAuthor = tabDescription.readEntry("Author", "");
-    tabIcon = skinDir + tabDescription.readEntry("Icon", "");
-
-    skinName = titleName.isEmpty() ? tabName : titleName;
-    skinAuthor = titleAuthor.isEmpty() ? tabAuthor : titleAuthor;
-    titleIcon.isEmpty() ? skinIcon.addPixmap(tabIcon) : skinIcon.addPixmap(titleIcon);
+    if (!skin.icon.isNull())
+        skinIcon.addPixmap(QPixmap::fromImage(skin.icon));
 
     if (skinName.isEmpty() || skinAuthor.isEmpty())
-        skinName = skinId;
+        skinName = skin.id;
 
     if (skinAuthor.isEmpty())
         skinAuthor = xi18nc("@item:inlistbox Unknown skin author", "Unknown");
 
-    QStandardItem *skin = new QStandardItem(skinName);
+    QStandardItem *item = new QStandardItem(skinName);
 
-    skin->setData(skinId, SkinId);
-    skin->setData(skinDir, SkinDir);
-    skin->setData(skinName, SkinName);
-    skin->setData(skinAuthor, SkinAuthor);
-    skin->setData(skinIcon, SkinIcon);
-    skin->setData(isKnsSkin, SkinInstalledWithKns);
+    item->setData(skin.id, SkinId);
+    item->setData(skin.dir, SkinDir);
+    item->setData(skinName, SkinName);
+    item->setData(skinAuthor, SkinAuthor);
+    item->setData(skinIcon, SkinIcon);
+    item->setData(skin.installedWithKns, SkinInstalledWithKns);
 
-    return skin;
+    return item;
 }
 
 void AppearanceSettings::updateSkinSetting()
@@ -192,9 +171,18 @@ void AppearanceSettings::installSkin()
     mimeTypes << QStringLiteral("application/zip");
     mimeTypes << QStringLiteral("application/x-tar");
 
+    QStringList patterns;
+    QMimeDatabase mimeDatabase;
+
+    for (const QString &mimeType : std::as_const(mimeTypes))
+        patterns << mimeDatabase.mimeTypeForName(mimeType).globPatterns();
+
+    // Compiled skin packages have no MIME type of their own.
+    patterns << QStringLiteral("*.rcc");
+
     QFileDialog fileDialog(parentWidget());
     fileDialog.setWindowTitle(i18nc("@title:window", "Select the skin archive to install"));
-    fileDialog.setMimeTypeFilters(mimeTypes);
+    fileDialog.setNameFilter(i18nc("@item:inlistbox", "Skin archives and packages") + QStringLiteral(" (") + patterns.join(QLatin1Char(' ')) + QLatin1Char(')'));
     fileDialog.setFileMode(QFileDialog::ExistingFile);
 
     QUrl skinUrl;
@@ -203,6 +191,11 @@ void AppearanceSettings::installSkin()
     else
         return;
 
+    if (skinUrl.isLocalFile()) {
+        installSkinArchive(skinUrl.toLocalFile());
+        return;
+    }
+
     m_installSkinFile.open();
 
     KIO::CopyJob *job = KIO::copy(skinUrl, QUrl::fromLocalFile(m_installSkinFile.fileName()), KIO::JobFlag::HideProgressInfo | KIO::JobFlag::Overwrite);
@@ -216,31 +209,20 @@ void AppearanceSettings::installSkin()
             return;
         }
 
-        installSkin(static_cast<KIO::CopyJob *>(job)->destUrl());
+        installSkinArchive(static_cast<KIO::CopyJob *>(job)->destUrl().toLocalFile());
     });
 }
 
-void AppearanceSettings::installSkin(const QUrl &skinUrl)
+void AppearanceSettings::installSkinArchive(const QString &archivePath)
 {
-    QUrl skinArchiveUrl = QUrl(skinUrl);
-    skinArchiveUrl.setScheme(QStringLiteral("tar"));
+    auto *job = new SkinInstallJob(archivePath, m_localSkinsDir, this);
+    KIO::getJobTracker()->registerJob(job);
 
-    KIO::ListJob *job = KIO::listRecursive(skinArchiveUrl, KIO::HideProgressInfo, KIO::ListJob::ListFlags{});
-    connect(job, &KIO::ListJob::entries, [=, this](KIO::Job * /* job */, const KIO::UDSEntryList &list) {
-        if (list.isEmpty())
-            return;
-
-        QListIterator<KIO::UDSEntry> i(list);
-        while (i.hasNext())
-            m_installSkinFileList.append(i.next().stringValue(KIO::UDSEntry::UDS_NAME));
+    connect(job, &KJob::result, this, [=, this]() {
+        finishInstall(job);
     });
 
-    connect(job, &KIO::ListJob::result, this, [=, this](KJob *job) {
-        if (!job->error())
-            checkForExistingSkin();
-        else
-            failInstall(xi18nc("@info", "Unable to list the skin archive contents.") + QStringLiteral("\n\n") + job->errorString());
-    });
+    job->start();
 }
 
 bool AppearanceSettings::validateSkin(const QString &skinId, bool kns)
@@ -250,12 +232,35 @@ bool AppearanceSettings::validateSkin(const QString &skinId, bool kns)
     QString titlePath = QStandardPaths::locate(QStandardPaths::AppDataLocation, dir + skinId + QStringLiteral("/title.skin"));
     QString tabsPath = QStandardPaths::locate(QStandardPaths::AppDataLocation, dir + skinId + QStringLiteral("/tabs.skin"));
 
-    return !titlePath.isEmpty() && !tabsPath.isEmpty();
+    if (!titlePath.isEmpty() && !tabsPath.isEmpty())
+        return true;
+
+    const QString packagePath = QStandardPaths::locate(QStandardPaths::AppDataLocation, dir + skinId + QStringLiteral(".rcc"));
+
+    return !packagePath.isEmpty() && SkinPackage(packagePath).skinId() == skinId;
+}
+
+bool AppearanceSettings::isSkinWritable(const QString &skinDir)
+{
+    const QFileInfo info(skinDir);
+
+    if (info.isFile())
+        return info.isWritable();
+
+    return QFileInfo(skinDir + QStringLiteral("/title.skin")).isWritable();
 }
 
-void AppearanceSettings::checkForExistingSkin()
+void AppearanceSettings::finishInstall(SkinInstallJob *job)
 {
-    m_installSkinId = m_installSkinFileList.at(0);
+    if (job->error() == KJob::KilledJobError) {
+        cleanupAfterInstall();
+        return;
+    } else if (job->error()) {
+        failInstall(job->errorText());
+        return;
+    }
+
+    m_installSkinId = job->skinId();
 
     const QModelIndexList skins = m_skins->match(m_skins->index(0, 0), SkinId, m_installSkinId, 1, Qt::MatchExactly | Qt::MatchWrap);
 
@@ -267,28 +272,33 @@ void AppearanceSettings::checkForExistingSkin()
     }
 
     if (exists > 0) {
-        QString skinDir = skins.at(0).data(SkinDir).toString();
-        QFile skin(skinDir + QStringLiteral("titles.skin"));
-
-        if (!skin.open(QIODevice::ReadWrite)) {
+        if (!isSkinWritable(skins.at(0).data(SkinDir).toString())) {
             failInstall(xi18nc("@info", "This skin appears to be already installed and you lack the required permissions to overwrite it."));
-        } else {
-            skin.close();
-
-            int remove = KMessageBox::warningContinueCancel(parentWidget(),
-                                                            xi18nc("@info", "This skin appears to be already installed. Do you want to overwrite it?"),
-                                                            xi18nc("@title:window", "Skin Already Exists"),
-                                                            KGuiItem(xi18nc("@action:button", "Reinstall Skin")));
-
-            if (remove == KMessageBox::Continue)
-                removeSkin(skinDir, [this]() {
-                    installSkinArchive();
-                });
-            else
-                cleanupAfterInstall();
+            return;
         }
-    } else
-        installSkinArchive();
+
+        int remove = KMessageBox::warningContinueCancel(parentWidget(),
+                                                        xi18nc("@info", "This skin appears to be already installed. Do you want to overwrite it?"),
+                                                        xi18nc("@title:window", "Skin Already Exists"),
+                                                        KGuiItem(xi18nc("@action:button", "Reinstall Skin")));
+
+        if (remove != KMessageBox::Continue) {
+            cleanupAfterInstall();
+            return;
+        }
+    }
+
+    if (!job->install()) {
+        failInstall(xi18nc("@info", "The skin could not be moved into <filename>%1</filename>.", m_localSkinsDir));
+        return;
+    }
+
+    populateSkinList();
+
+    if (Settings::skin() == m_installSkinId)
+        Q_EMIT settingsChanged();
+
+    cleanupAfterInstall();
 }
 
 void AppearanceSettings::removeSkin(const QString &skinDir, std::function<void()> successCallback)
@@ -303,30 +313,6 @@ void AppearanceSettings::removeSkin(const QString &skinDir, std::function<void()
     });
 }
 
-void AppearanceSettings::installSkinArchive()
-{
-    KTar skinArchive(m_installSkinFile.fileName());
-
-    if (skinArchive.open(QIODevice::ReadOnly)) {
-        const KArchiveDirectory *skinDir = skinArchive.directory();
-        skinDir->copyTo(m_localSkinsDir);
-        skinArchive.close();
-
-        if (validateSkin(m_installSkinId, false)) {
-            populateSkinList();
-
-            if (Settings::skin() == m_installSkinId)
-                Q_EMIT settingsChanged();
-
-            cleanupAfterInstall();
-        } else {
-            removeSkin(m_localSkinsDir + m_installSkinId);
-            failInstall(xi18nc("@info", "Unable to locate required files in the skin archive.<nl/><nl/>The archive appears to be invalid."));
-        }
-    } else
-        failInstall(xi18nc("@info", "The skin archive file could not be opened."));
-}
-
 void AppearanceSettings::failInstall(const QString &error)
 {
     KMessageBox::error(parentWidget(), error, xi18nc("@title:window", "Cannot Install Skin"));
@@ -337,7 +323,6 @@ void AppearanceSettings::failInstall(const QString &error)
 void AppearanceSettings::cleanupAfterInstall()
 {
     m_installSkinId.clear();
-    m_installSkinFileList.clear();
 
     if (m_installSkinFile.exists()) {
         m_installSkinFile.close();
@@ -355,7 +340,7 @@ void AppearanceSettings::updateRemoveSkinButton()
     const QString skinDir = skinList->currentIndex().data(SkinDir).toString();
     bool enabled = false;
     if (!skinDir.isEmpty()) {
-        enabled = QFileInfo(skinDir + QStringLiteral("/title.skin")).isWritable();
+        enabled = isSkinWritable(skinDir);
     }
     removeButton->setEnabled(enabled);
 }
@@ -410,6 +395,10 @@ QSet<QString> AppearanceSettings::extractKnsSkinIds(const QStringList &fileList)
                 // First remove all remaining slashes (as there could be leading or trailing ones).
                 skinId.remove(QStringLiteral("/"));
 
+                // Packaged skins are named after their ID.
+                if (skinId.endsWith(QLatin1String(".rcc")))
+                    skinId.chop(4);
+
                 skinIdList.insert(skinId);
             }
         }
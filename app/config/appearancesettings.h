@@ -13,7 +13,10 @@
 
 #include <KIO/Job>
 
+class SkinInstallJob;
 class SkinListDelegate;
+class SkinScanner;
+struct SkinInfo;
 
 class QStandardItem;
 class QStandardItemModel;
@@ -46,11 +49,12 @@ protected:
 
 private Q_SLOTS:
     void populateSkinList();
+    void addSkinItem(const SkinInfo &skin);
+    void skinListPopulated();
 
     void updateSkinSetting();
 
     void installSkin();
-    void installSkinArchive();
 
     /**
      * Validates the given skin.
@@ -64,6 +68,13 @@ private Q_SLOTS:
      */
     bool validateSkin(const QString &skinId, bool kns);
 
+    /**
+     * Checks whether an installed skin may be replaced or removed.
+     *
+     * @param skinDir The skin directory, or the file of a packaged skin.
+     */
+    bool isSkinWritable(const QString &skinDir);
+
     /**
      * Extracts the skin IDs from the given fileList.
      * There can be multiple skins, but only one skin per directory.
@@ -82,12 +93,11 @@ private Q_SLOTS:
     void removeSelectedSkin();
 
 private:
-    QStandardItem *createSkinItem(const QString &skinDir);
+    QStandardItem *createSkinItem(const SkinInfo &skin);
 
-    void populateSkinList(const QString &installationDirectory);
-    void checkForExistingSkin();
     void removeSkin(const QString &skinDir, std::function<void()> successCallback = nullptr);
-    void installSkin(const QUrl &skinUrl);
+    void installSkinArchive(const QString &archivePath);
+    void finishInstall(SkinInstallJob *job);
     void failInstall(const QString &error);
     void cleanupAfterInstall();
 
@@ -95,12 +105,12 @@ private:
 
     QStandardItemModel *m_skins = nullptr;
     SkinListDelegate *m_skinListDelegate = nullptr;
+    SkinScanner *m_skinScanner = nullptr;
 
     QString m_localSkinsDir;
     QString m_knsSkinDir;
     QString m_installSkinId;
     QTemporaryFile m_installSkinFile;
-    QStringList m_installSkinFileList;
 
     QString m_knsConfigFileName;
 };
@@ -0,0 +1,414 @@
+/*
+  SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+  SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "skininstalljob.h"
+#include "skinpackage.h"
+
+#include <KArchiveDirectory>
+#include <KArchiveFile>
+#include <KLocalizedString>
+#include <KTar>
+#include <KZip>
+
+#include <QBuffer>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QMimeDatabase>
+
+static const qint64 ChunkSize = 64 * 1024;
+
+static qint64 archiveSize(const KArchiveDirectory *dir)
+{
+    qint64 size = 0;
+
+    const QStringList entries = dir->entries();
+
+    for (const QString &name : entries) {
+        const KArchiveEntry *entry = dir->entry(name);
+
+        if (entry->isFile())
+            size += static_cast<const KArchiveFile *>(entry)->size();
+        else if (entry->isDirectory())
+            size += archiveSize(static_cast<const KArchiveDirectory *>(entry));
+    }
+
+    return size;
+}
+
+static bool isImage(const QString &fileName)
+{
+    static const QList<QByteArray> formats = QImageReader::supportedImageFormats();
+
+    return formats.contains(QFileInfo(fileName).suffix().toLower().toLatin1());
+}
+
+SkinInstallJob::SkinInstallJob(const QString &archivePath, const QString &skinsDir, QObject *parent)
+    : KJob(parent)
+    , m_archivePath(archivePath)
+    , m_skinsDir(QDir::cleanPath(skinsDir))
+{
+    m_pool.setMaxThreadCount(1);
+}
+
+SkinInstallJob::~SkinInstallJob()
+{
+    if (m_cancelled)
+        m_cancelled->store(true);
+
+    m_pool.waitForDone();
+}
+
+void SkinInstallJob::start()
+{
+    Q_EMIT description(this, i18nc("@title job", "Installing Skin"), qMakePair(i18nc("The archive a skin is installed from", "Archive"), m_archivePath));
+
+    QDir().mkpath(m_skinsDir);
+
+    // Staged next to the skins directory rather than inside it, so that the
+    // skin list never picks up a half-extracted skin, and on the same file
+    // system, so that install() can rename.
+    m_stagingDir = std::make_unique<QTemporaryDir>(m_skinsDir + QStringLiteral(".install-XXXXXX"));
+
+    if (!m_stagingDir->isValid()) {
+        setError(WriteError);
+        setErrorText(m_stagingDir->errorString());
+        emitResult();
+
+        return;
+    }
+
+    m_isPackage = SkinPackage::isPackage(m_archivePath);
+
+    m_cancelled = std::make_shared<std::atomic<bool>>(false);
+
+    std::shared_ptr<std::atomic<bool>> cancelled = m_cancelled;
+
+    m_pool.start([this, cancelled]() {
+        run(cancelled);
+    });
+}
+
+bool SkinInstallJob::doKill()
+{
+    if (m_cancelled)
+        m_cancelled->store(true);
+
+    return true;
+}
+
+// Runs on the worker thread.
+void SkinInstallJob::run(std::shared_ptr<std::atomic<bool>> cancelled)
+{
+    if (m_isPackage) {
+        runPackage(*cancelled);
+        return;
+    }
+
+    const QMimeType mimeType = QMimeDatabase().mimeTypeForFile(m_archivePath);
+
+    std::unique_ptr<KArchive> archive;
+
+    if (mimeType.inherits(QStringLiteral("application/zip")))
+        archive = std::make_unique<KZip>(m_archivePath);
+    else
+        archive = std::make_unique<KTar>(m_archivePath);
+
+    if (!archive->open(QIODevice::ReadOnly)) {
+        finish(OpenError, xi18nc("@info", "The skin archive file could not be opened."), QString());
+        return;
+    }
+
+    // The skin is the first top-level directory that holds both descriptors.
+    const KArchiveDirectory *root = archive->directory();
+    const KArchiveDirectory *skinDir = nullptr;
+    QString skinId;
+
+    const QStringList entries = root->entries();
+
+    for (const QString &name : entries) {
+        const KArchiveEntry *entry = root->entry(name);
+
+        if (!entry->isDirectory() || name == QLatin1String(".") || name == QLatin1String(".."))
+            continue;
+
+        const auto *dir = static_cast<const KArchiveDirectory *>(entry);
+
+        if (dir->file(QStringLiteral("title.skin")) && dir->file(QStringLiteral("tabs.skin"))) {
+            skinDir = dir;
+            skinId = name;
+            break;
+        }
+    }
+
+    if (!skinDir) {
+        finish(InvalidSkinError, xi18nc("@info", "Unable to locate required files in the skin archive.<nl/><nl/>The archive appears to be invalid."), QString());
+        return;
+    }
+
+    m_totalBytes = archiveSize(skinDir);
+    m_processedBytes = 0;
+
+    const qint64 totalBytes = m_totalBytes;
+
+    QMetaObject::invokeMethod(
+        this,
+        [this, totalBytes]() {
+            setTotalAmount(Bytes, totalBytes);
+        },
+        Qt::QueuedConnection);
+
+    if (!extract(skinDir, m_stagingDir->path() + QLatin1Char('/') + skinId, *cancelled)) {
+        finish(cancelled->load() ? int(KilledJobError) : m_errorCode, m_errorText, QString());
+        return;
+    }
+
+    finish(NoError, QString(), skinId);
+}
+
+// Runs on the worker thread. A package is installed as it is, after checking
+// its contents through a temporary mount.
+void SkinInstallJob::runPackage(const std::atomic<bool> &cancelled)
+{
+    const SkinPackage package(m_archivePath);
+
+    if (!package.isValid()) {
+        finish(OpenError, xi18nc("@info", "The skin archive file could not be opened."), QString());
+        return;
+    }
+
+    const QString skinId = package.skinId();
+
+    if (skinId.isEmpty()) {
+        finish(InvalidSkinError, xi18nc("@info", "Unable to locate required files in the skin archive.<nl/><nl/>The archive appears to be invalid."), QString());
+        return;
+    }
+
+    QDirIterator it(package.root() + QLatin1Char('/') + skinId, QDir::Files, QDirIterator::Subdirectories);
+
+    while (it.hasNext()) {
+        const QString path = it.next();
+
+        if (cancelled.load()) {
+            finish(KilledJobError, QString(), QString());
+            return;
+        }
+
+        if (isImage(path) && QImageReader(path).read().isNull()) {
+            finish(InvalidImageError,
+                   xi18nc("@info",
+                          "The image <filename>%1</filename> in the skin archive could not be read.<nl/><nl/>The archive appears to be invalid.",
+                          it.fileName()),
+                   QString());
+            return;
+        }
+    }
+
+    QFile input(m_archivePath);
+    const QString outputPath = m_stagingDir->path() + QLatin1Char('/') + skinId + QStringLiteral(".rcc");
+    QFile output(outputPath);
+
+    if (!input.open(QIODevice::ReadOnly) || !output.open(QIODevice::WriteOnly)) {
+        finish(WriteError, xi18nc("@info", "Unable to write <filename>%1</filename>.", outputPath), QString());
+        return;
+    }
+
+    const qint64 totalBytes = input.size();
+
+    QMetaObject::invokeMethod(
+        this,
+        [this, totalBytes]() {
+            setTotalAmount(Bytes, totalBytes);
+        },
+        Qt::QueuedConnection);
+
+    qint64 processedBytes = 0;
+
+    while (!input.atEnd()) {
+        if (cancelled.load()) {
+            finish(KilledJobError, QString(), QString());
+            return;
+        }
+
+        const QByteArray chunk = input.read(ChunkSize);
+
+        if (chunk.isEmpty())
+            break;
+
+        if (output.write(chunk) != chunk.size()) {
+            finish(WriteError, xi18nc("@info", "Unable to write <filename>%1</filename>.", outputPath), QString());
+            return;
+        }
+
+        processedBytes += chunk.size();
+
+        QMetaObject::invokeMethod(
+            this,
+            [this, processedBytes]() {
+                setProcessedAmount(Bytes, processedBytes);
+            },
+            Qt::QueuedConnection);
+    }
+
+    finish(NoError, QString(), skinId);
+}
+
+// Runs on the worker thread. Files are copied in chunks; images are also
+// kept in memory until they have been test-decoded.
+bool SkinInstallJob::extract(const KArchiveDirectory *dir, const QString &path, const std::atomic<bool> &cancelled)
+{
+    if (!QDir().mkpath(path)) {
+        m_errorCode = WriteError;
+        m_errorText = xi18nc("@info", "Unable to create the skin directory <filename>%1</filename>.", path);
+        return false;
+    }
+
+    const QStringList entries = dir->entries();
+
+    for (const QString &name : entries) {
+        if (cancelled.load())
+            return false;
+
+        if (name == QLatin1String(".") || name == QLatin1String("..") || name.contains(QLatin1Char('/')))
+            continue;
+
+        const KArchiveEntry *entry = dir->entry(name);
+        const QString filePath = path + QLatin1Char('/') + name;
+
+        if (entry->isDirectory()) {
+            if (!extract(static_cast<const KArchiveDirectory *>(entry), filePath, cancelled))
+                return false;
+
+            continue;
+        }
+
+        if (!entry->isFile())
+            continue;
+
+        const auto *archiveFile = static_cast<const KArchiveFile *>(entry);
+        std::unique_ptr<QIODevice> input(archiveFile->createDevice());
+        QFile output(filePath);
+
+        if (!input || !output.open(QIODevice::WriteOnly)) {
+            m_errorCode = WriteError;
+            m_errorText = xi18nc("@info", "Unable to write <filename>%1</filename>.", filePath);
+            return false;
+        }
+
+        const bool image = isImage(name);
+        QByteArray imageData;
+
+        while (!input->atEnd()) {
+            if (cancelled.load())
+                return false;
+
+            const QByteArray chunk = input->read(ChunkSize);
+
+            if (chunk.isEmpty())
+                break;
+
+            if (output.write(chunk) != chunk.size()) {
+                m_errorCode = WriteError;
+                m_errorText = xi18nc("@info", "Unable to write <filename>%1</filename>.", filePath);
+                return false;
+            }
+
+            if (image)
+                imageData.append(chunk);
+
+            m_processedBytes += chunk.size();
+        }
+
+        output.close();
+
+        if (image) {
+            QBuffer buffer(&imageData);
+            QImageReader reader(&buffer, QFileInfo(name).suffix().toLower().toLatin1());
+
+            if (reader.read().isNull()) {
+                m_errorCode = InvalidImageError;
+                m_errorText = xi18nc("@info", "The image <filename>%1</filename> in the skin archive could not be read.<nl/><nl/>The archive appears to be invalid.", name);
+                return false;
+            }
+        }
+
+        const qint64 processedBytes = m_processedBytes;
+
+        QMetaObject::invokeMethod(
+            this,
+            [this, processedBytes]() {
+                setProcessedAmount(Bytes, processedBytes);
+            },
+            Qt::QueuedConnection);
+    }
+
+    return true;
+}
+
+void SkinInstallJob::finish(int error, const QString &errorText, const QString &skinId)
+{
+    QMetaObject::invokeMethod(
+        this,
+        [this, error, errorText, skinId]() {
+            m_skinId = skinId;
+
+            if (error != NoError) {
+                m_stagingDir.reset();
+
+                setError(error);
+                setErrorText(errorText);
+            }
+
+            emitResult();
+        },
+        Qt::QueuedConnection);
+}
+
+bool SkinInstallJob::install()
+{
+    if (error() || m_skinId.isEmpty() || !m_stagingDir)
+        return false;
+
+    const QString stagedName = m_isPackage ? m_skinId + QStringLiteral(".rcc") : m_skinId;
+
+    // An installed skin of the same id is moved aside first, and only removed
+    // once the new one is in place, so it survives a failed rename. Both
+    // kinds are moved, as a directory would shadow a package.
+    const QStringList installedNames = {m_skinId, m_skinId + QStringLiteral(".rcc")};
+    QStringList movedNames;
+
+    auto restore = [&]() {
+        for (const QString &name : std::as_const(movedNames))
+            QDir().rename(m_stagingDir->path() + QStringLiteral("/.previous-") + name, m_skinsDir + QLatin1Char('/') + name);
+    };
+
+    for (const QString &name : installedNames) {
+        const QString path = m_skinsDir + QLatin1Char('/') + name;
+
+        if (!QFileInfo::exists(path))
+            continue;
+
+        if (!QDir().rename(path, m_stagingDir->path() + QStringLiteral("/.previous-") + name)) {
+            restore();
+            return false;
+        }
+
+        movedNames.append(name);
+    }
+
+    if (!QDir().rename(m_stagingDir->path() + QLatin1Char('/') + stagedName, m_skinsDir + QLatin1Char('/') + stagedName)) {
+        restore();
+        return false;
+    }
+
+    m_stagingDir.reset();
+
+    return true;
+}
+
+#include "moc_skininstalljob.cpp"
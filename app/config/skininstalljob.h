@@ -0,0 +1,81 @@
+/*
+  SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+  SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#ifndef SKININSTALLJOB_H
+#define SKININSTALLJOB_H
+
+#include <KJob>
+
+#include <QString>
+#include <QTemporaryDir>
+#include <QThreadPool>
+
+#include <atomic>
+#include <memory>
+
+class KArchiveDirectory;
+
+// Unpacks a skin archive, or copies a skin package, on a worker thread. The
+// skin is validated in the same pass: it has to carry title.skin and
+// tabs.skin and every image in it has to decode. The files are staged in a
+// temporary directory next to the skins directory; install() then moves the
+// skin into place with a rename, so a failed or cancelled install never
+// leaves a half-written skin behind.
+class SkinInstallJob : public KJob
+{
+    Q_OBJECT
+
+public:
+    enum Error {
+        OpenError = UserDefinedError + 1,
+        InvalidSkinError,
+        InvalidImageError,
+        WriteError,
+    };
+
+    SkinInstallJob(const QString &archivePath, const QString &skinsDir, QObject *parent = nullptr);
+    ~SkinInstallJob() override;
+
+    void start() override;
+
+    // The id of the skin found in the archive, valid once the job finished.
+    QString skinId() const
+    {
+        return m_skinId;
+    }
+
+    // Moves the staged skin into the skins directory, replacing an already
+    // installed skin of the same id.
+    bool install();
+
+protected:
+    bool doKill() override;
+
+private:
+    void run(std::shared_ptr<std::atomic<bool>> cancelled);
+    void runPackage(const std::atomic<bool> &cancelled);
+    bool extract(const KArchiveDirectory *dir, const QString &path, const std::atomic<bool> &cancelled);
+    void finish(int error, const QString &errorText, const QString &skinId);
+
+    QString m_archivePath;
+    QString m_skinsDir;
+    QString m_skinId;
+    bool m_isPackage = false;
+
+    std::unique_ptr<QTemporaryDir> m_stagingDir;
+
+    QThreadPool m_pool;
+    std::shared_ptr<std::atomic<bool>> m_cancelled;
+
+    qint64 m_totalBytes = 0;
+    qint64 m_processedBytes = 0;
+
+    // Written by the worker thread only.
+    int m_errorCode = NoError;
+    QString m_errorText;
+};
+
+#endif
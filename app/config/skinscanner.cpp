@@ -0,0 +1,297 @@
+/*
+  SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+  SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "skinscanner.h"
+#include "skinpackage.h"
+
+#include <KConfig>
+#include <KConfigGroup>
+
+#include <QDataStream>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QImageReader>
+#include <QSaveFile>
+#include <QSet>
+#include <QStandardPaths>
+
+static const quint32 CacheMagic = 0x59534b4c; // "YSKL"
+static const quint32 CacheVersion = 1;
+
+// Twice the size the skin list paints icons at, to stay sharp on HiDPI.
+static const int ThumbnailSize = 64;
+
+namespace
+{
+struct CacheEntry {
+    qint64 dirModified = 0;
+    qint64 titleModified = 0;
+    qint64 tabModified = 0;
+    QString name;
+    QString author;
+    QImage icon;
+};
+}
+
+static qint64 lastModified(const QString &path)
+{
+    return QFileInfo(path).lastModified().toMSecsSinceEpoch();
+}
+
+static QString cacheFilePath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/skinlist.cache");
+}
+
+static QHash<QString, CacheEntry> readCache()
+{
+    QHash<QString, CacheEntry> cache;
+
+    QFile file(cacheFilePath());
+
+    if (!file.open(QIODevice::ReadOnly))
+        return cache;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_6_0);
+
+    quint32 magic;
+    quint32 version;
+    quint32 count;
+
+    stream >> magic >> version >> count;
+
+    if (magic != CacheMagic || version != CacheVersion)
+        return cache;
+
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        QString dir;
+        CacheEntry entry;
+
+        stream >> dir >> entry.dirModified >> entry.titleModified >> entry.tabModified >> entry.name >> entry.author >> entry.icon;
+
+        if (stream.status() == QDataStream::Ok)
+            cache.insert(dir, entry);
+    }
+
+    return cache;
+}
+
+static void writeCache(const QHash<QString, CacheEntry> &cache)
+{
+    const QString path = cacheFilePath();
+    QDir().mkpath(QFileInfo(path).absolutePath());
+
+    QSaveFile file(path);
+
+    if (!file.open(QIODevice::WriteOnly))
+        return;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_6_0);
+
+    stream << CacheMagic << CacheVersion << quint32(cache.size());
+
+    for (auto it = cache.cbegin(); it != cache.cend(); ++it) {
+        const CacheEntry &entry = it.value();
+        stream << it.key() << entry.dirModified << entry.titleModified << entry.tabModified << entry.name << entry.author << entry.icon;
+    }
+
+    file.commit();
+}
+
+static QImage readThumbnail(const QString &path)
+{
+    QImageReader reader(path);
+
+    const QSize size = reader.size();
+
+    if (size.isValid() && (size.width() > ThumbnailSize || size.height() > ThumbnailSize))
+        reader.setScaledSize(size.scaled(ThumbnailSize, ThumbnailSize, Qt::KeepAspectRatio));
+
+    return reader.read();
+}
+
+static CacheEntry readSkin(const QString &skinDir)
+{
+    CacheEntry entry;
+
+    KConfig titleConfig(skinDir + QStringLiteral("/title.skin"), KConfig::SimpleConfig);
+    KConfigGroup titleDescription = titleConfig.group(QStringLiteral("Description"));
+
+    KConfig tabConfig(skinDir + QStringLiteral("/tabs.skin"), KConfig::SimpleConfig);
+    KConfigGroup tabDescription = tabConfig.group(QStringLiteral("Description"));
+
+    const QString titleName = titleDescription.readEntry("Skin", "");
+    const QString titleAuthor = titleDescription.readEntry("Author", "");
+    const QString titleIcon = titleDescription.readEntry("Icon", "");
+
+    const QString tabName = tabDescription.readEntry("Skin", "");
+    const QString tabAuthor = tabDescription.readEntry("Author", "");
+    const QString tabIcon = tabDescription.readEntry("Icon", "");
+
+    entry.name = titleName.isEmpty() ? tabName : titleName;
+    entry.author = titleAuthor.isEmpty() ? tabAuthor : titleAuthor;
+
+    const QString icon = titleIcon.isEmpty() ? tabIcon : titleIcon;
+
+    if (!icon.isEmpty())
+        entry.icon = readThumbnail(skinDir + icon);
+
+    return entry;
+}
+
+SkinScanner::SkinScanner(QObject *parent)
+    : QObject(parent)
+{
+    // One scan at a time, so that scans don't race on the cache file.
+    m_pool.setMaxThreadCount(1);
+}
+
+SkinScanner::~SkinScanner()
+{
+    if (m_cancelled)
+        m_cancelled->store(true);
+
+    m_pool.waitForDone();
+}
+
+void SkinScanner::scan(const QStringList &locations, const QString &knsSkinDir)
+{
+    if (m_cancelled)
+        m_cancelled->store(true);
+
+    m_cancelled = std::make_shared<std::atomic<bool>>(false);
+
+    const int generation = ++m_generation;
+    std::shared_ptr<std::atomic<bool>> cancelled = m_cancelled;
+
+    m_pool.start([this, locations, knsSkinDir, generation, cancelled]() {
+        run(locations, knsSkinDir, generation, cancelled);
+    });
+}
+
+// Runs on the worker thread. Results are handed to the GUI thread one skin
+// at a time; those of a scan that has since been superseded are dropped there.
+void SkinScanner::run(const QStringList &locations, const QString &knsSkinDir, int generation, std::shared_ptr<std::atomic<bool>> cancelled)
+{
+    const QHash<QString, CacheEntry> cache = readCache();
+    QHash<QString, CacheEntry> updatedCache;
+    bool cacheChanged = false;
+
+    // Like Skin::load(), the first location holding a skin wins; that's how
+    // a local "default" skin overrides the built-in one.
+    QSet<QString> foundIds;
+
+    auto report = [&](const QString &dir, const QString &id, qint64 dirModified, qint64 titleModified, qint64 tabModified, const QString &skinDir) {
+        const bool installedWithKns = dir.startsWith(knsSkinDir);
+
+        if (!installedWithKns) {
+            if (foundIds.contains(id))
+                return;
+
+            foundIds.insert(id);
+        }
+
+        CacheEntry entry = cache.value(dir);
+
+        if (!cache.contains(dir) || entry.dirModified != dirModified || entry.titleModified != titleModified || entry.tabModified != tabModified) {
+            entry = readSkin(skinDir);
+            entry.dirModified = dirModified;
+            entry.titleModified = titleModified;
+            entry.tabModified = tabModified;
+
+            cacheChanged = true;
+        }
+
+        updatedCache.insert(dir, entry);
+
+        SkinInfo skin;
+        skin.id = id;
+        skin.dir = dir;
+        skin.name = entry.name;
+        skin.author = entry.author;
+        skin.icon = entry.icon;
+        skin.installedWithKns = installedWithKns;
+
+        QMetaObject::invokeMethod(
+            this,
+            [this, generation, skin]() {
+                if (generation == m_generation)
+                    Q_EMIT skinFound(skin);
+            },
+            Qt::QueuedConnection);
+    };
+
+    for (const QString &location : locations) {
+        QDirIterator it(location, QDir::Dirs | QDir::NoDotAndDotDot);
+
+        while (it.hasNext()) {
+            if (cancelled->load())
+                return;
+
+            const QDir skinDir(it.next());
+
+            if (!skinDir.exists(QStringLiteral("title.skin")) || !skinDir.exists(QStringLiteral("tabs.skin")))
+                continue;
+
+            const QString dir = skinDir.absolutePath();
+
+            // The directory changes when files are added, removed or
+            // replaced; the configs are checked as well since they are
+            // commonly edited in place.
+            report(dir,
+                   dir.section(QLatin1Char('/'), -1, -1),
+                   lastModified(dir),
+                   lastModified(dir + QStringLiteral("/title.skin")),
+                   lastModified(dir + QStringLiteral("/tabs.skin")),
+                   dir);
+        }
+
+        QDirIterator packages(location, {QStringLiteral("*.rcc")}, QDir::Files);
+
+        while (packages.hasNext()) {
+            if (cancelled->load())
+                return;
+
+            const QFileInfo info(packages.next());
+            const QString path = info.absoluteFilePath();
+            const QString id = info.completeBaseName();
+            const qint64 modified = lastModified(path);
+
+            // Packages only need to be mounted when they aren't cached yet.
+            const CacheEntry &cached = cache.value(path);
+
+            if (cache.contains(path) && cached.dirModified == modified) {
+                report(path, id, modified, modified, modified, QString());
+                continue;
+            }
+
+            const SkinPackage package(path);
+
+            if (package.skinId() != id)
+                continue;
+
+            report(path, id, modified, modified, modified, package.root() + QLatin1Char('/') + id);
+        }
+    }
+
+    if (cacheChanged || updatedCache.size() != cache.size())
+        writeCache(updatedCache);
+
+    QMetaObject::invokeMethod(
+        this,
+        [this, generation]() {
+            if (generation == m_generation)
+                Q_EMIT finished();
+        },
+        Qt::QueuedConnection);
+}
+
+#include "moc_skinscanner.cpp"
@@ -0,0 +1,56 @@
+/*
+  SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+  SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#ifndef SKINSCANNER_H
+#define SKINSCANNER_H
+
+#include <QImage>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+
+#include <atomic>
+#include <memory>
+
+struct SkinInfo {
+    QString id;
+    // The skin directory, or the file of a packaged skin.
+    QString dir;
+    QString name;
+    QString author;
+    QImage icon;
+    bool installedWithKns = false;
+};
+
+// Finds the installed skins on a worker thread and reports them one by one.
+// Names, authors and icon thumbnails are cached on disk per skin directory,
+// so a rescan only reads the skins that changed since the last one.
+class SkinScanner : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SkinScanner(QObject *parent = nullptr);
+    ~SkinScanner() override;
+
+    // Cancels a scan that is still running.
+    void scan(const QStringList &locations, const QString &knsSkinDir);
+
+Q_SIGNALS:
+    void skinFound(const SkinInfo &skin);
+    void finished();
+
+private:
+    void run(const QStringList &locations, const QString &knsSkinDir, int generation, std::shared_ptr<std::atomic<bool>> cancelled);
+
+    QThreadPool m_pool;
+
+    int m_generation = 0;
+    std::shared_ptr<std::atomic<bool>> m_cancelled;
+};
+
+#endif
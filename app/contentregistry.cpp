@@ -0,0 +1,44 @@
+/*
+  SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+  SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "contentregistry.h"
+#include "browser.h"
+#include "terminal.h"
+
+ContentRegistry *ContentRegistry::self()
+{
+    static ContentRegistry instance;
+
+    return &instance;
+}
+
+int ContentRegistry::allocateId()
+{
+    return m_availableId++;
+}
+
+void ContentRegistry::addTerminal(Session *session, Terminal *terminal)
+{
+    Entry entry;
+    entry.session = session;
+    entry.terminal = terminal;
+
+    m_entries.insert(terminal->id(), entry);
+}
+
+void ContentRegistry::addBrowser(Session *session, Browser *browser)
+{
+    Entry entry;
+    entry.session = session;
+    entry.browser = browser;
+
+    m_entries.insert(browser->id(), entry);
+}
+
+void ContentRegistry::remove(int contentId)
+{
+    m_entries.remove(contentId);
+}
@@ -0,0 +1,60 @@
+/*
+  SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+  SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#ifndef CONTENTREGISTRY_H
+#define CONTENTREGISTRY_H
+
+#include <QHash>
+
+class Browser;
+class Session;
+class Terminal;
+
+// Hands out the ids of terminals and browsers from a single counter, so a
+// content id names exactly one object, and maps each id to its session and
+// object for constant-time lookups.
+class ContentRegistry
+{
+public:
+    struct Entry {
+        Session *session = nullptr;
+        Terminal *terminal = nullptr;
+        Browser *browser = nullptr;
+    };
+
+    static ContentRegistry *self();
+
+    int allocateId();
+
+    void addTerminal(Session *session, Terminal *terminal);
+    void addBrowser(Session *session, Browser *browser);
+    void remove(int contentId);
+
+    Entry entry(int contentId) const
+    {
+        return m_entries.value(contentId);
+    }
+    Session *session(int contentId) const
+    {
+        return m_entries.value(contentId).session;
+    }
+    Terminal *terminal(int contentId) const
+    {
+        return m_entries.value(contentId).terminal;
+    }
+    Browser *browser(int contentId) const
+    {
+        return m_entries.value(contentId).browser;
+    }
+
+private:
+    ContentRegistry() = default;
+
+    int m_availableId = 0;
+    QHash<int, Entry> m_entries;
+};
+
+#endif
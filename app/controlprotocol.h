@@ -0,0 +1,78 @@
+/*
+  SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+  SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#ifndef CONTROLPROTOCOL_H
+#define CONTROLPROTOCOL_H
+
+#include <QByteArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QList>
+#include <QStandardPaths>
+#include <QString>
+#include <QtEndian>
+
+// The framing of the control socket, shared by the server and yakuakectl.
+//
+// Every message is a compact JSON object preceded by its length as a 32-bit
+// big-endian integer. A request is {"id", "object", "method", "args"}, where
+// object is "window", "tabs" or "sessions" and method is one of the
+// scriptable slots of that object, and is answered by {"id", "result"} or
+// {"id", "error"}. Requests may be pipelined; answers come in order. After
+// {"id", "method": "subscribe"}, the server also pushes {"event", "args"}
+// for each of the scriptable signals of the sessions object.
+namespace ControlProtocol
+{
+const quint32 MaxMessageSize = 16 * 1024 * 1024;
+
+inline QString socketPath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::RuntimeLocation) + QStringLiteral("/yakuake-control");
+}
+
+inline QByteArray encode(const QJsonObject &message)
+{
+    const QByteArray payload = QJsonDocument(message).toJson(QJsonDocument::Compact);
+
+    QByteArray frame(sizeof(quint32), Qt::Uninitialized);
+    qToBigEndian<quint32>(payload.size(), frame.data());
+    frame.append(payload);
+
+    return frame;
+}
+
+// Takes all complete messages off the front of buffer. Returns false if the
+// stream is malformed and the connection should be dropped.
+inline bool decode(QByteArray &buffer, QList<QJsonObject> &messages)
+{
+    qsizetype offset = 0;
+
+    while (buffer.size() - offset >= qsizetype(sizeof(quint32))) {
+        const quint32 size = qFromBigEndian<quint32>(buffer.constData() + offset);
+
+        if (size > MaxMessageSize)
+            return false;
+
+        if (buffer.size() - offset - qsizetype(sizeof(quint32)) < qsizetype(size))
+            break;
+
+        QJsonParseError error;
+        const QJsonDocument document = QJsonDocument::fromJson(buffer.mid(offset + sizeof(quint32), size), &error);
+
+        if (error.error != QJsonParseError::NoError || !document.isObject())
+            return false;
+
+        messages.append(document.object());
+        offset += sizeof(quint32) + size;
+    }
+
+    buffer.remove(0, offset);
+
+    return true;
+}
+}
+
+#endif
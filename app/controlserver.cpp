@@ -0,0 +1,330 @@
+/*
+  SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+  SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "controlserver.h"
+#include "controlprotocol.h"
+#include "mainwindow.h"
+#include "sessionstack.h"
+#include "tabbar.h"
+#include "yakuake_debug.h"
+
+#include <QLocalSocket>
+#include <QMetaMethod>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+ControlServer::ControlServer(MainWindow *mainWindow, SessionStack *sessionStack, TabBar *tabBar)
+    : QObject(mainWindow)
+{
+    m_objects.insert(QStringLiteral("window"), mainWindow);
+    m_objects.insert(QStringLiteral("tabs"), tabBar);
+    m_objects.insert(QStringLiteral("sessions"), sessionStack);
+
+    m_server.setSocketOptions(QLocalServer::UserAccessOption);
+    connect(&m_server, &QLocalServer::newConnection, this, &ControlServer::acceptConnections);
+
+    connect(sessionStack, &SessionStack::structureChanged, this, [this]() {
+        pushEvent(QStringLiteral("structureChanged"), QJsonArray());
+    });
+    connect(sessionStack, &SessionStack::sessionTitleChanged, this, [this](int sessionId, const QString &title) {
+        pushEvent(QStringLiteral("sessionTitleChanged"), QJsonArray{sessionId, title});
+    });
+    connect(sessionStack, &SessionStack::focusChanged, this, [this](int sessionId, int contentId) {
+        pushEvent(QStringLiteral("focusChanged"), QJsonArray{sessionId, contentId});
+    });
+    connect(sessionStack, &SessionStack::contentActivityDetected, this, [this](int sessionId, int contentId) {
+        pushEvent(QStringLiteral("contentActivityDetected"), QJsonArray{sessionId, contentId});
+    });
+    connect(sessionStack, &SessionStack::contentSilenceDetected, this, [this](int sessionId, int contentId) {
+        pushEvent(QStringLiteral("contentSilenceDetected"), QJsonArray{sessionId, contentId});
+    });
+}
+
+ControlServer::~ControlServer()
+{
+    const QList<QLocalSocket *> sockets = m_clients.keys();
+
+    for (QLocalSocket *socket : sockets) {
+        socket->disconnect(this);
+        socket->abort();
+        delete socket;
+    }
+
+    m_server.close();
+}
+
+bool ControlServer::listen()
+{
+    const QString path = ControlProtocol::socketPath();
+
+    if (m_server.listen(path))
+        return true;
+
+    // A socket left at the path is only removed once it refuses a
+    // connection, so a live server is never taken over.
+    if (m_server.serverError() == QAbstractSocket::AddressInUseError) {
+        QLocalSocket probe;
+        probe.connectToServer(path);
+
+        if (!probe.waitForConnected(100)) {
+            QLocalServer::removeServer(path);
+
+            if (m_server.listen(path))
+                return true;
+        }
+    }
+
+    qCWarning(YAKUAKE_LOG) << "Unable to open the control socket" << path << m_server.errorString();
+
+    return false;
+}
+
+void ControlServer::acceptConnections()
+{
+    while (QLocalSocket *socket = m_server.nextPendingConnection()) {
+        if (!isPeerTrusted(socket)) {
+            qCWarning(YAKUAKE_LOG) << "Refused a control socket connection from another user";
+            socket->abort();
+            socket->deleteLater();
+            continue;
+        }
+
+        m_clients.insert(socket, Client());
+
+        connect(socket, &QLocalSocket::readyRead, this, [this, socket]() {
+            readClient(socket);
+        });
+        connect(socket, &QLocalSocket::disconnected, this, [this, socket]() {
+            m_clients.remove(socket);
+            socket->deleteLater();
+        });
+    }
+}
+
+bool ControlServer::isPeerTrusted(QLocalSocket *socket) const
+{
+    const int fd = int(socket->socketDescriptor());
+
+#if defined(Q_OS_LINUX)
+    struct ucred credentials;
+    socklen_t length = sizeof(credentials);
+
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &length) != 0)
+        return false;
+
+    return credentials.uid == getuid();
+#elif defined(Q_OS_UNIX)
+    uid_t uid;
+    gid_t gid;
+
+    if (getpeereid(fd, &uid, &gid) != 0)
+        return false;
+
+    return uid == getuid();
+#else
+    Q_UNUSED(fd);
+
+    return false;
+#endif
+}
+
+void ControlServer::readClient(QLocalSocket *socket)
+{
+    auto client = m_clients.find(socket);
+
+    if (client == m_clients.end())
+        return;
+
+    client->buffer.append(socket->readAll());
+
+    if (!ControlProtocol::decode(client->buffer, client->requests)) {
+        qCWarning(YAKUAKE_LOG) << "Dropped a control socket connection sending malformed messages";
+        socket->abort();
+        return;
+    }
+
+    if (!client->requests.isEmpty())
+        scheduleClient(socket);
+}
+
+void ControlServer::scheduleClient(QLocalSocket *socket)
+{
+    if (!m_pendingClients.contains(socket))
+        m_pendingClients.append(socket);
+
+    drainClients();
+}
+
+// Serves the waiting clients from one loop. A slot may open a dialog and
+// spin the event loop; other clients are then served from there, while the
+// client whose request is running stays queued, so its requests never run
+// out of order.
+void ControlServer::drainClients()
+{
+    int index = 0;
+
+    while (index < m_pendingClients.count()) {
+        QLocalSocket *socket = m_pendingClients.at(index);
+        auto client = m_clients.find(socket);
+
+        if (client == m_clients.end()) {
+            m_pendingClients.removeAt(index);
+            continue;
+        }
+
+        if (client->busy) {
+            ++index;
+            continue;
+        }
+
+        m_pendingClients.removeAt(index);
+        processClient(socket);
+
+        // The queue may have changed while a slot was running.
+        index = 0;
+    }
+}
+
+void ControlServer::processClient(QLocalSocket *socket)
+{
+    m_clients[socket].busy = true;
+
+    // Requests are answered in the order they came in, and the answers to a
+    // pipelined batch leave in one write.
+    QByteArray replies;
+
+    while (m_clients.contains(socket) && !m_clients[socket].requests.isEmpty()) {
+        const QJsonObject request = m_clients[socket].requests.takeFirst();
+
+        replies.append(ControlProtocol::encode(handleRequest(socket, request)));
+    }
+
+    if (m_clients.contains(socket)) {
+        m_clients[socket].busy = false;
+
+        if (!replies.isEmpty())
+            socket->write(replies);
+    }
+}
+
+QJsonObject ControlServer::handleRequest(QLocalSocket *socket, const QJsonObject &request)
+{
+    QJsonObject reply;
+    reply[QLatin1String("id")] = request.value(QLatin1String("id"));
+
+    const QString method = request.value(QLatin1String("method")).toString();
+
+    if (method == QLatin1String("subscribe")) {
+        m_clients[socket].subscribed = true;
+        reply[QLatin1String("result")] = true;
+
+        return reply;
+    }
+
+    QObject *object = m_objects.value(request.value(QLatin1String("object")).toString(QStringLiteral("sessions")));
+
+    if (!object) {
+        reply[QLatin1String("error")] = QStringLiteral("unknown object");
+        return reply;
+    }
+
+    QString error;
+    const QJsonValue result = invoke(object, method, request.value(QLatin1String("args")).toArray(), error);
+
+    if (error.isEmpty())
+        reply[QLatin1String("result")] = result;
+    else
+        reply[QLatin1String("error")] = error;
+
+    return reply;
+}
+
+QJsonValue ControlServer::invoke(QObject *object, const QString &name, const QJsonArray &args, QString &error)
+{
+    const QMetaObject *metaObject = object->metaObject();
+    const QByteArray methodName = name.toLatin1();
+
+    for (int i = metaObject->methodOffset(); i < metaObject->methodCount(); ++i) {
+        const QMetaMethod method = metaObject->method(i);
+
+        // Methods with default arguments have one entry per arity.
+        if (method.methodType() != QMetaMethod::Slot || !(method.attributes() & QMetaMethod::Scriptable) || method.name() != methodName
+            || method.parameterCount() != args.count()) {
+            continue;
+        }
+
+        if (args.count() > 10) {
+            error = QStringLiteral("too many arguments");
+            return QJsonValue();
+        }
+
+        QVariantList values;
+
+        for (int j = 0; j < args.count(); ++j) {
+            QVariant value = args.at(j).toVariant();
+
+            if (!value.convert(method.parameterMetaType(j))) {
+                error = QStringLiteral("argument %1 has the wrong type").arg(j + 1);
+                return QJsonValue();
+            }
+
+            values.append(value);
+        }
+
+        QGenericArgument arguments[10];
+
+        for (int j = 0; j < values.count(); ++j)
+            arguments[j] = QGenericArgument(values[j].typeName(), values[j].constData());
+
+        QVariant result;
+        QGenericReturnArgument returnArgument;
+
+        if (method.returnMetaType().id() != QMetaType::Void) {
+            result = QVariant(method.returnMetaType());
+            returnArgument = QGenericReturnArgument(method.typeName(), result.data());
+        }
+
+        if (!method.invoke(object,
+                           Qt::DirectConnection,
+                           returnArgument,
+                           arguments[0],
+                           arguments[1],
+                           arguments[2],
+                           arguments[3],
+                           arguments[4],
+                           arguments[5],
+                           arguments[6],
+                           arguments[7],
+                           arguments[8],
+                           arguments[9])) {
+            error = QStringLiteral("the call failed");
+            return QJsonValue();
+        }
+
+        return QJsonValue::fromVariant(result);
+    }
+
+    error = QStringLiteral("unknown method");
+
+    return QJsonValue();
+}
+
+void ControlServer::pushEvent(const QString &event, const QJsonArray &args)
+{
+    QJsonObject message;
+    message[QLatin1String("event")] = event;
+    message[QLatin1String("args")] = args;
+
+    const QByteArray frame = ControlProtocol::encode(message);
+
+    for (auto it = m_clients.cbegin(); it != m_clients.cend(); ++it) {
+        if (it->subscribed)
+            it.key()->write(frame);
+    }
+}
+
+#include "moc_controlserver.cpp"
@@ -0,0 +1,65 @@
+/*
+  SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+  SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#ifndef CONTROLSERVER_H
+#define CONTROLSERVER_H
+
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QList>
+#include <QLocalServer>
+#include <QObject>
+
+class MainWindow;
+class SessionStack;
+class TabBar;
+
+class QLocalSocket;
+
+// Serves the scriptable slots of the main window, the tab bar and the
+// session stack on a local socket in the runtime directory, using the
+// framing in controlprotocol.h. Only connections from the same user are
+// accepted: the socket file is private and the peer's uid is checked.
+class ControlServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    ControlServer(MainWindow *mainWindow, SessionStack *sessionStack, TabBar *tabBar);
+    ~ControlServer() override;
+
+    bool listen();
+
+private Q_SLOTS:
+    void acceptConnections();
+
+private:
+    struct Client {
+        QByteArray buffer;
+        QList<QJsonObject> requests;
+        bool subscribed = false;
+        bool busy = false;
+    };
+
+    bool isPeerTrusted(QLocalSocket *socket) const;
+    void readClient(QLocalSocket *socket);
+    void scheduleClient(QLocalSocket *socket);
+    void drainClients();
+    void processClient(QLocalSocket *socket);
+    QJsonObject handleRequest(QLocalSocket *socket, const QJsonObject &request);
+    QJsonValue invoke(QObject *object, const QString &name, const QJsonArray &args, QString &error);
+    void pushEvent(const QString &event, const QJsonArray &args);
+
+    QLocalServer m_server;
+    QHash<QLocalSocket *, Client> m_clients;
+    QHash<QString, QObject *> m_objects;
+
+    // Clients with requests waiting, in the order they sent them.
+    QList<QLocalSocket *> m_pendingClients;
+};
+
+#endif
@@ -0,0 +1,89 @@
+/*
+  SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+  SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "framescheduler.h"
+
+#include <QGuiApplication>
+#include <QScreen>
+#include <QWidget>
+
+#include <algorithm>
+#include <utility>
+
+FrameScheduler *FrameScheduler::self()
+{
+    static FrameScheduler *instance = new FrameScheduler(qApp);
+
+    return instance;
+}
+
+FrameScheduler::FrameScheduler(QObject *parent)
+    : QObject(parent)
+{
+    m_flushTimer.setSingleShot(true);
+    m_flushTimer.setTimerType(Qt::PreciseTimer);
+    connect(&m_flushTimer, &QTimer::timeout, this, &FrameScheduler::flush);
+}
+
+FrameScheduler::~FrameScheduler() = default;
+
+void FrameScheduler::scheduleUpdate(QWidget *widget)
+{
+    scheduleUpdate(widget, widget->rect());
+}
+
+void FrameScheduler::scheduleUpdate(QWidget *widget, const QRegion &region)
+{
+    if (!widget || region.isEmpty())
+        return;
+
+    ++m_requestedUpdates;
+
+    auto it = std::find_if(m_dirtyWidgets.begin(), m_dirtyWidgets.end(), [widget](const DirtyWidget &dirtyWidget) {
+        return dirtyWidget.widget == widget;
+    });
+
+    if (it != m_dirtyWidgets.end())
+        it->region += region;
+    else
+        m_dirtyWidgets.append({widget, region});
+
+    if (m_flushTimer.isActive())
+        return;
+
+    // Flush right away if the last flush is already older than one refresh
+    // interval, otherwise wait out the rest of the interval.
+    const int interval = frameInterval(widget);
+    const qint64 sinceLastFlush = m_lastFlush.isValid() ? m_lastFlush.elapsed() : interval;
+
+    m_flushTimer.start(qMax<qint64>(0, interval - sinceLastFlush));
+}
+
+int FrameScheduler::frameInterval(const QWidget *widget) const
+{
+    const QScreen *screen = widget ? widget->screen() : QGuiApplication::primaryScreen();
+    const qreal refreshRate = screen ? screen->refreshRate() : 60.0;
+
+    return qMax(1, qRound(1000.0 / qMax(refreshRate, 1.0)));
+}
+
+void FrameScheduler::flush()
+{
+    m_lastFlush.start();
+
+    const QList<DirtyWidget> dirtyWidgets = std::exchange(m_dirtyWidgets, {});
+
+    for (const DirtyWidget &dirtyWidget : dirtyWidgets) {
+        if (!dirtyWidget.widget)
+            continue;
+
+        dirtyWidget.widget->update(dirtyWidget.region);
+
+        ++m_deliveredUpdates;
+    }
+}
+
+#include "moc_framescheduler.cpp"
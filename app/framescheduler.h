@@ -0,0 +1,74 @@
+/*
+  SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+  SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#ifndef FRAMESCHEDULER_H
+#define FRAMESCHEDULER_H
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QRegion>
+#include <QTimer>
+
+class QWidget;
+
+// Collects repaint requests from the window chrome (title bar, tab bar,
+// visual event overlay and the main window frame) and hands them to
+// QWidget::update() on a timer paced to the screen's refresh rate. It does
+// not track presentation; it only keeps bursts of requests, and the work
+// the callers defer until painting, to one pass per interval.
+class FrameScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    static FrameScheduler *self();
+
+    ~FrameScheduler() override;
+
+    void scheduleUpdate(QWidget *widget);
+    void scheduleUpdate(QWidget *widget, const QRegion &region);
+
+    int frameInterval(const QWidget *widget = nullptr) const;
+
+    // Counted since startup: the scheduleUpdate() calls, the update() calls
+    // they ended up as, and the difference, i.e. the requests merged into a
+    // pending update of the same widget (or dropped along with the widget).
+    quint64 requestedUpdates() const
+    {
+        return m_requestedUpdates;
+    }
+    quint64 deliveredUpdates() const
+    {
+        return m_deliveredUpdates;
+    }
+    quint64 mergedUpdates() const
+    {
+        return m_requestedUpdates - m_deliveredUpdates;
+    }
+
+private Q_SLOTS:
+    void flush();
+
+private:
+    explicit FrameScheduler(QObject *parent = nullptr);
+
+    struct DirtyWidget {
+        QPointer<QWidget> widget;
+        QRegion region;
+    };
+
+    QList<DirtyWidget> m_dirtyWidgets;
+
+    QTimer m_flushTimer;
+    QElapsedTimer m_lastFlush;
+
+    quint64 m_requestedUpdates = 0;
+    quint64 m_deliveredUpdates = 0;
+};
+
+#endif
@@ -10,7 +10,9 @@
 #include "browser.h"
 #include "config/appearancesettings.h"
 #include "config/windowsettings.h"
+#include "controlserver.h"
 #include "firstrundialog.h"
+#include "framescheduler.h"
 #include "sessionstack.h"
 #include "settings.h"
 #include "skin.h"
@@ -18,6 +20,7 @@
 #include "terminal.h"
 #include "titlebar.h"
 #include "ui_behaviorsettings.h"
+#include "yakuake_debug.h"
 
 #include <KAboutData>
 #include <KActionCollection>
@@ -42,8 +45,11 @@
 #include <QDBusConnection>
 #include <QDBusPendingReply>
 #include <QDBusReply>
+#include <QElapsedTimer>
 #include <QMenu>
+#include <QPaintEvent>
 #include <QPainter>
+#include <QPixmapCache>
 #include <QScreen>
 #include <QWhatsThis>
 #include <QWindow>
@@ -72,11 +78,13 @@ MainWindow::MainWindow(QWidget *parent)
     setAttribute(Qt::WA_QuitOnClose, true);
 
     m_skin = new Skin();
+    connect(m_skin, &Skin::changed, this, &MainWindow::applySkinChanges);
     m_menu = new QMenu(this);
     m_helpMenu = new KHelpMenu(this, KAboutData::applicationData());
     m_sessionStack = new SessionStack(this);
     m_titleBar = new TitleBar(this);
     m_tabBar = new TabBar(this);
+    m_sessionStack->setTabBar(m_tabBar);
     m_notifierItem = nullptr;
 
     m_firstRunDialog = nullptr;
@@ -108,6 +116,14 @@ MainWindow::MainWindow(QWidget *parent)
     connect(m_tabBar, &TabBar::tabTitleEdited, m_sessionStack, [&](int, QString) {
         m_sessionStack->raiseSession(m_sessionStack->activeSessionId());
     });
+    connect(m_tabBar, &TabBar::tabTitleEdited, m_sessionStack, &SessionStack::notifyTitleChanged);
+    connect(m_tabBar, &TabBar::tabTitlesEdited, m_sessionStack, [&](const QList<int> &sessionIds) {
+        m_sessionStack->raiseSession(m_sessionStack->activeSessionId());
+
+        for (int sessionId : sessionIds)
+            m_sessionStack->notifyTitleChanged(sessionId);
+    });
+    connect(m_tabBar, &TabBar::tabsReordered, m_sessionStack, &SessionStack::notifyStructureChanged);
     connect(m_tabBar, SIGNAL(requestTerminalHighlight(int)), m_sessionStack, SLOT(handleHighlightRequest(int)));
     connect(m_tabBar, SIGNAL(requestRemoveTerminalHighlight()), m_sessionStack, SIGNAL(removeTerminalHighlight()));
     connect(m_tabBar, SIGNAL(tabContextMenuClosed()), m_sessionStack, SIGNAL(removeTerminalHighlight()));
@@ -123,6 +139,9 @@ MainWindow::MainWindow(QWidget *parent)
 
     connect(&m_mousePoller, SIGNAL(timeout()), this, SLOT(pollMouse()));
 
+    m_releaseCachesTimer.setSingleShot(true);
+    connect(&m_releaseCachesTimer, &QTimer::timeout, this, &MainWindow::releaseCaches);
+
     if (KWindowSystem::isPlatformX11()) {
         connect(KX11Extras::self(), &KX11Extras::workAreaChanged, this, &MainWindow::applyWindowGeometry);
     }
@@ -330,6 +349,18 @@ void MainWindow::setupActions()
     connect(action, SIGNAL(triggered()), this, SLOT(handleContextDependentAction()));
     m_contextDependentActions << action;
 
+    action = actionCollection()->addAction(QStringLiteral("close-other-sessions"));
+    action->setText(xi18nc("@action", "Close Other Sessions"));
+    action->setIcon(QIcon::fromTheme(QStringLiteral("tab-close-other")));
+    connect(action, SIGNAL(triggered()), this, SLOT(handleContextDependentAction()));
+    m_contextDependentActions << action;
+
+    action = actionCollection()->addAction(QStringLiteral("close-sessions-to-the-right"));
+    action->setText(xi18nc("@action", "Close Sessions to the Right"));
+    action->setIcon(QIcon::fromTheme(QStringLiteral("tab-close-right")));
+    connect(action, SIGNAL(triggered()), this, SLOT(handleContextDependentAction()));
+    m_contextDependentActions << action;
+
     action = actionCollection()->addAction(QStringLiteral("previous-session"));
     action->setText(xi18nc("@action", "Previous Session"));
     action->setIcon(QIcon::fromTheme(QStringLiteral("go-previous")));
@@ -498,6 +529,27 @@ void MainWindow::handleContextDependentAction(QAction *action, int sessionId)
     if (action == actionCollection()->action(QStringLiteral("close-session")))
         m_sessionStack->removeSession(sessionId);
 
+    if (action == actionCollection()->action(QStringLiteral("close-other-sessions"))
+        || action == actionCollection()->action(QStringLiteral("close-sessions-to-the-right"))) {
+        QList<int> sessionIds = m_tabBar->sessionIds();
+        const int index = sessionIds.indexOf(sessionId);
+
+        if (index == -1)
+            return;
+
+        if (action == actionCollection()->action(QStringLiteral("close-other-sessions")))
+            sessionIds.removeAt(index);
+        else
+            sessionIds = sessionIds.mid(index + 1);
+
+        // Raising the kept session first spares the tab bar from selecting
+        // each of its neighbours in turn as they go away.
+        if (sessionIds.contains(m_sessionStack->activeSessionId()))
+            m_sessionStack->raiseSession(sessionId);
+
+        m_sessionStack->removeSessions(sessionIds);
+    }
+
     if (action == actionCollection()->action(QStringLiteral("move-session-left")))
         m_tabBar->moveTabLeft(sessionId);
 
@@ -547,7 +599,7 @@ void MainWindow::handleContextDependentToggleAction(bool checked, QAction *actio
 
         // Repaint the tab bar when the Prevent Closing action is toggled
         // so the lock icon is added to or removed from the tab label.
-        m_tabBar->repaint();
+        m_tabBar->scheduleRepaint();
     }
 
     if (action == actionCollection()->action(QStringLiteral("toggle-session-keyboard-input")))
@@ -616,7 +668,7 @@ void MainWindow::handleToggleTerminalMonitorSilence(bool checked)
 void MainWindow::handleActivity(Session *session, int id)
 {
     if (session->contentType() == Session::TerminalType) {
-        disconnect(session->getTerminal(id), SIGNAL(activityDetected(Terminal *)), session, SIGNAL(activityDetected(Terminal *)));
+        disconnect(session->getTerminal(id), SIGNAL(activityDetected(Terminal *)), session, SLOT(handleActivity(Terminal *)));
 
         QString message = xi18nc("@info", "Activity detected in monitored terminal in session %1.", m_tabBar->tabTitle(session->id()));
 
@@ -918,7 +970,7 @@ void MainWindow::applySettings()
         updateTrayTooltip();
     }
 
-    repaint(); // used to repaint skin borders if Settings::hideSkinBorders has been changed
+    FrameScheduler::self()->scheduleUpdate(this); // used to repaint skin borders if Settings::hideSkinBorders has been changed
 
     setKeepOpen(Settings::keepOpen());
 
@@ -930,15 +982,29 @@ void MainWindow::applySettings()
     applySkin();
     applyWindowGeometry();
     applyWindowProperties();
+
+    m_skin->setWatchFiles(Settings::watchSkinFiles());
+
+    if (Settings::enableControlSocket() && !m_controlServer) {
+        m_controlServer = new ControlServer(this, m_sessionStack, m_tabBar);
+
+        if (!m_controlServer->listen()) {
+            delete m_controlServer;
+            m_controlServer = nullptr;
+        }
+    } else if (!Settings::enableControlSocket() && m_controlServer) {
+        delete m_controlServer;
+        m_controlServer = nullptr;
+    }
 }
 
 void MainWindow::applySkin()
 {
-    bool gotSkin = m_skin->load(Settings::skin(), Settings::skinInstalledWithKns());
+    bool gotSkin = m_skin->load(Settings::skin(), Settings::skinInstalledWithKns(), devicePixelRatioF());
 
     if (!gotSkin) {
         Settings::setSkin(QStringLiteral("default"));
-        gotSkin = m_skin->load(Settings::skin());
+        gotSkin = m_skin->load(Settings::skin(), false, devicePixelRatioF());
     }
 
     if (!gotSkin) {
@@ -955,6 +1021,32 @@ void MainWindow::applySkin()
     m_tabBar->applySkin();
 }
 
+// Renders the skin again when the window ends up with a different scale
+// factor, e.g. on another screen. Released caches come back at the right
+// scale anyway.
+void MainWindow::updateDevicePixelRatio()
+{
+    if (m_cachesReleased || qFuzzyCompare(m_skin->devicePixelRatio(), devicePixelRatioF()))
+        return;
+
+    applySkin();
+}
+
+void MainWindow::applySkinChanges(Skin::Sections sections)
+{
+    if (sections & Skin::TitleBarSection)
+        m_titleBar->applySkin();
+
+    if (sections & Skin::TabBarSection)
+        m_tabBar->applySkin();
+
+    if (sections & Skin::GeometrySection)
+        applyWindowGeometry();
+
+    if (sections & Skin::BorderSection)
+        FrameScheduler::self()->scheduleUpdate(this);
+}
+
 void MainWindow::applyWindowProperties()
 {
     if (m_isX11) {
@@ -1111,29 +1203,60 @@ void MainWindow::updateMask()
 
 void MainWindow::paintEvent(QPaintEvent *event)
 {
+    updateFrameCache();
+
     QPainter painter(this);
 
-    if (useTranslucency()) {
-        painter.setOpacity(qreal(Settings::backgroundColorOpacity()) / 100);
-        painter.fillRect(rect(), Settings::backgroundColor());
-        painter.setOpacity(1.0);
-    } else
-        painter.fillRect(rect(), Settings::backgroundColor());
+    // The backing store is cleared before painting a translucent window,
+    // so the fills can replace instead of blend.
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
 
-    if (!Settings::hideSkinBorders()) {
-        const QRect leftBorder(0, 0, m_skin->borderWidth(), height() - m_titleBar->height());
-        painter.fillRect(leftBorder, m_skin->borderColor());
+    for (const QRect &rect : event->region() & m_frameCache.backgroundRegion)
+        painter.fillRect(rect, m_frameCache.backgroundColor);
 
-        const QRect rightBorder(width() - m_skin->borderWidth(), 0, m_skin->borderWidth(), height() - m_titleBar->height());
-        painter.fillRect(rightBorder, m_skin->borderColor());
+    for (const QRect &rect : event->region() & m_frameCache.borderRegion)
+        painter.fillRect(rect, m_frameCache.borderColor);
 
-        const QRect bottomBorder(0, height() - m_skin->borderWidth() - m_titleBar->height(), width(), m_skin->borderWidth());
-        painter.fillRect(bottomBorder, m_skin->borderColor());
-    }
+    painter.end();
 
     KMainWindow::paintEvent(event);
 }
 
+void MainWindow::updateFrameCache()
+{
+    QColor backgroundColor = Settings::backgroundColor();
+
+    if (useTranslucency())
+        backgroundColor.setAlphaF(qreal(Settings::backgroundColorOpacity()) / 100);
+
+    const bool bordersVisible = !Settings::hideSkinBorders();
+
+    if (m_frameCache.size == size() && m_frameCache.backgroundColor == backgroundColor && m_frameCache.borderColor == m_skin->borderColor()
+        && m_frameCache.borderWidth == m_skin->borderWidth() && m_frameCache.titleBarHeight == m_titleBar->height()
+        && m_frameCache.bordersVisible == bordersVisible)
+        return;
+
+    m_frameCache.size = size();
+    m_frameCache.backgroundColor = backgroundColor;
+    m_frameCache.borderColor = m_skin->borderColor();
+    m_frameCache.borderWidth = m_skin->borderWidth();
+    m_frameCache.titleBarHeight = m_titleBar->height();
+    m_frameCache.bordersVisible = bordersVisible;
+
+    m_frameCache.borderRegion = QRegion();
+
+    if (bordersVisible) {
+        const int borderWidth = m_frameCache.borderWidth;
+        const int titleBarHeight = m_frameCache.titleBarHeight;
+
+        m_frameCache.borderRegion += QRect(0, 0, borderWidth, height() - titleBarHeight);
+        m_frameCache.borderRegion += QRect(width() - borderWidth, 0, borderWidth, height() - titleBarHeight);
+        m_frameCache.borderRegion += QRect(0, height() - borderWidth - titleBarHeight, width(), borderWidth);
+    }
+
+    m_frameCache.backgroundRegion = QRegion(rect()) - m_frameCache.borderRegion;
+}
+
 void MainWindow::moveEvent(QMoveEvent *event)
 {
     const QList<QScreen *> screens = qApp->screens();
@@ -1182,6 +1305,9 @@ void MainWindow::wmActiveWindowChanged()
 void MainWindow::showEvent(QShowEvent *event)
 {
     KMainWindow::showEvent(event);
+
+    connect(windowHandle(), &QWindow::screenChanged, this, &MainWindow::updateDevicePixelRatio, Qt::UniqueConnection);
+
     KWindowSystem::activateWindow(windowHandle());
     if (m_sessionStack->activeSessionId() != -1) {
         Session *session = m_sessionStack->session(m_sessionStack->activeSessionId());
@@ -1203,9 +1329,22 @@ void MainWindow::changeEvent(QEvent *event)
         }
     }
 
+    if (event->type() == QEvent::PaletteChange)
+        m_skin->updateColorScheme();
+
     KMainWindow::changeEvent(event);
 }
 
+bool MainWindow::event(QEvent *event)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(6, 6, 0)
+    if (event->type() == QEvent::DevicePixelRatioChange)
+        updateDevicePixelRatio();
+#endif
+
+    return KMainWindow::event(event);
+}
+
 bool MainWindow::focusNextPrevChild(bool)
 {
     return false;
@@ -1457,6 +1596,11 @@ void MainWindow::xshapeRetractWindow()
 
 void MainWindow::sharedPreOpenWindow()
 {
+    m_releaseCachesTimer.stop();
+
+    if (m_cachesReleased)
+        restoreCaches();
+
     applyWindowGeometry();
 
     updateUseTranslucency();
@@ -1494,6 +1638,9 @@ void MainWindow::sharedAfterHideWindow()
     if (Settings::pollMouse())
         toggleMousePoll(true);
 
+    if (Settings::releaseCachesWhenHidden())
+        m_releaseCachesTimer.start(Settings::releaseCachesDelay() * 1000);
+
 #if HAVE_KWAYLAND
     delete m_plasmaShellSurface;
     m_plasmaShellSurface = nullptr;
@@ -1502,6 +1649,50 @@ void MainWindow::sharedAfterHideWindow()
     Q_EMIT windowClosed();
 }
 
+// Drops what the window chrome can rebuild: the skin images, the themed
+// lock icon, the rendered title bar, the frame regions and Qt's pixmap cache.
+// Widget backing stores are owned by Qt and stay alive.
+void MainWindow::releaseCaches()
+{
+    if (isVisible() || m_cachesReleased)
+        return;
+
+    m_releasedCacheBytes = m_skin->releaseCaches() + m_titleBar->releaseCaches();
+
+    m_frameCache = FrameCache();
+    QPixmapCache::clear();
+
+    m_cachesReleased = true;
+
+    qCDebug(YAKUAKE_LOG) << "Released" << m_releasedCacheBytes << "bytes of window chrome caches while retracted";
+}
+
+// Called before the window opens; Skin::restoreCaches() bounds the time this
+// takes. Should a decode outlast that bound, the chrome is repainted through
+// Skin::changed() once it is done.
+void MainWindow::restoreCaches()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    m_cachesReleased = false;
+    m_releasedCacheBytes = 0;
+
+    if (m_skin->restoreCaches(devicePixelRatioF())) {
+        m_titleBar->applySkin();
+        m_tabBar->applySkin();
+
+        qCDebug(YAKUAKE_LOG) << "Restored skin images in" << timer.elapsed() << "ms";
+    } else {
+        qCDebug(YAKUAKE_LOG) << "Decoding skin images in the background";
+    }
+}
+
+qlonglong MainWindow::releasedCacheBytes() const
+{
+    return m_releasedCacheBytes;
+}
+
 void MainWindow::activate()
 {
     KWindowSystem::activateWindow(windowHandle());
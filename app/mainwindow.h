@@ -8,15 +8,19 @@
 #ifndef MAINWINDOW_H
 #define MAINWINDOW_H
 
+#include "skin.h"
+
 #include <config-yakuake.h>
 
 #include <KMainWindow>
 
+#include <QColor>
+#include <QRegion>
 #include <QTimer>
 
+class ControlServer;
 class FirstRunDialog;
 class SessionStack;
-class Skin;
 class TabBar;
 class Terminal;
 class Browser;
@@ -77,6 +81,10 @@ public:
 public Q_SLOTS:
     Q_SCRIPTABLE void toggleWindowState();
 
+    // The bytes freed by releasing the window chrome caches while retracted,
+    // 0 while they are in use.
+    Q_SCRIPTABLE qlonglong releasedCacheBytes() const;
+
     void handleContextDependentAction(QAction *action = nullptr, int sessionId = -1);
     void handleContextDependentToggleAction(bool checked, QAction *action = nullptr, int sessionId = -1);
     void handleToggleTerminalKeyboardInput(bool checked);
@@ -95,6 +103,7 @@ protected:
     void paintEvent(QPaintEvent *) override;
     void moveEvent(QMoveEvent *) override;
     void changeEvent(QEvent *event) override;
+    bool event(QEvent *event) override;
     void closeEvent(QCloseEvent *event) override;
     bool focusNextPrevChild(bool) override;
 
@@ -103,6 +112,8 @@ protected:
 private Q_SLOTS:
     void applySettings();
     void applySkin();
+    void applySkinChanges(Skin::Sections sections);
+    void updateDevicePixelRatio();
     void applyWindowProperties();
 
     void applyWindowGeometry();
@@ -131,6 +142,8 @@ private Q_SLOTS:
     void toggleMousePoll(bool poll);
     void pollMouse();
 
+    void releaseCaches();
+
     void setKeepOpen(bool keepOpen);
 
     void setFullScreen(bool state);
@@ -172,6 +185,8 @@ private:
     void sharedPreHideWindow();
     void sharedAfterHideWindow();
 
+    void restoreCaches();
+
     void updateMask();
 
     int getScreen();
@@ -184,6 +199,22 @@ private:
 
     void slideWindow();
 
+    void updateFrameCache();
+
+    // The window frame is made of flat fills only, so the cache holds the
+    // resolved colors and the regions they cover rather than pixels.
+    struct FrameCache {
+        QSize size;
+        QColor backgroundColor;
+        QColor borderColor;
+        int borderWidth = 0;
+        int titleBarHeight = 0;
+        bool bordersVisible = false;
+        QRegion backgroundRegion;
+        QRegion borderRegion;
+    };
+    FrameCache m_frameCache;
+
     void updateUseTranslucency();
     bool m_useTranslucency;
     bool m_isFullscreen;
@@ -207,6 +238,12 @@ private:
 
     QTimer m_animationTimer;
     QTimer m_mousePoller;
+    QTimer m_releaseCachesTimer;
+    bool m_cachesReleased = false;
+    qint64 m_releasedCacheBytes = 0;
+
+    ControlServer *m_controlServer = nullptr;
+
     int m_animationFrame;
     int m_animationStepSize;
 
@@ -7,8 +7,12 @@
 
 #include "session.h"
 #include "browser.h"
+#include "contentregistry.h"
 #include "terminal.h"
 
+#include <QJsonArray>
+#include <QLineEdit>
+
 #include <algorithm>
 
 int Session::m_availableSessionId = 0;
@@ -141,6 +145,9 @@ void Session::setupSession(SessionType type)
             break;
         }
 
+        case Custom:
+            break;
+
         default: {
             addTerminal(m_baseSplitter);
 
@@ -170,12 +177,14 @@ Terminal *Session::addTerminal(QSplitter *parent, QString workingDir)
     connect(terminal, SIGNAL(manuallyActivated(Terminal *)), this, SIGNAL(terminalManuallyActivated(Terminal *)));
     connect(terminal, SIGNAL(titleChanged(int, QString)), this, SLOT(setTitle(int, QString)));
     connect(terminal, SIGNAL(keyboardInputBlocked(Terminal *)), this, SIGNAL(keyboardInputBlocked(Terminal *)));
-    connect(terminal, SIGNAL(silenceDetected(Terminal *)), this, SIGNAL(silenceDetected(Session *, int)));
+    connect(terminal, SIGNAL(silenceDetected(Terminal *)), this, SLOT(handleSilence(Terminal *)));
     connect(terminal, &Terminal::closeRequested, this, QOverload<int>::of(&Session::cleanup));
 
     m_terminals[terminal->id()] = terminal;
+    ContentRegistry::self()->addTerminal(this, terminal);
 
     Q_EMIT wantsBlurChanged();
+    Q_EMIT contentChanged();
 
     parent->addWidget(terminal->partWidget());
     QWidget *terminalWidget = terminal->terminalWidget();
@@ -194,8 +203,10 @@ Browser *Session::addBrowser(QSplitter *parent)
     connect(browser, &Browser::closeRequested, this, QOverload<int>::of(&Session::cleanup));
 
     m_browsers[browser->id()] = browser;
+    ContentRegistry::self()->addBrowser(this, browser);
 
     Q_EMIT wantsBlurChanged();
+    Q_EMIT contentChanged();
 
     parent->addWidget(browser->partWidget());
     QWidget *browserWidget = browser->browserWidget();
@@ -567,7 +578,11 @@ int Session::tryGrow(int id, GrowthDirection direction, uint pixels)
 
 void Session::setActiveId(int id)
 {
-    m_activeId = id;
+    if (m_activeId != id) {
+        m_activeId = id;
+
+        Q_EMIT activeIdChanged();
+    }
 
     if (m_contentType == TerminalType) {
         setTitle(m_activeId, m_terminals[m_activeId]->title());
@@ -576,12 +591,21 @@ void Session::setActiveId(int id)
     }
 }
 
+void Session::handleActivity(Terminal *terminal)
+{
+    Q_EMIT activityDetected(this, terminal->id());
+}
+
+void Session::handleSilence(Terminal *terminal)
+{
+    Q_EMIT silenceDetected(this, terminal->id());
+}
+
 void Session::setTitle(int id, const QString &title)
 {
-    if (id == m_activeId) {
+    if (id == m_activeId && title != m_title) {
         m_title = title;
 
-        Q_EMIT titleChanged(m_title);
         Q_EMIT titleChanged(m_sessionId, m_title);
     }
 }
@@ -602,6 +626,7 @@ void Session::cleanup(int id)
         m_browsers.erase(id);
     }
     Q_EMIT wantsBlurChanged();
+    Q_EMIT contentChanged();
 
     cleanup();
 }
@@ -640,6 +665,17 @@ const QString Session::terminalIdList()
     return idList.join(QLatin1Char(','));
 }
 
+QList<int> Session::terminalIds() const
+{
+    QList<int> ids;
+    ids.reserve(m_terminals.size());
+
+    for (auto &[id, terminal] : m_terminals)
+        ids << id;
+
+    return ids;
+}
+
 bool Session::hasTerminal(int terminalId)
 {
     return m_terminals.contains(terminalId);
@@ -803,7 +839,7 @@ void Session::setMonitorActivityEnabled(int terminalId, bool enabled)
 
     Terminal *terminal = m_terminals[terminalId];
 
-    connect(terminal, SIGNAL(activityDetected(Terminal *)), this, SIGNAL(activityDetected(Session *, int)), Qt::UniqueConnection);
+    connect(terminal, SIGNAL(activityDetected(Terminal *)), this, SLOT(handleActivity(Terminal *)), Qt::UniqueConnection);
 
     terminal->setMonitorActivityEnabled(enabled);
 }
@@ -828,7 +864,7 @@ void Session::reconnectMonitorActivitySignals()
 {
     for (auto &[id, terminal] : m_terminals) {
         // clang-format off
-        connect(terminal, SIGNAL(activityDetected(Terminal*)), this, SIGNAL(activityDetected(Session*,int)), Qt::UniqueConnection);
+        connect(terminal, SIGNAL(activityDetected(Terminal*)), this, SLOT(handleActivity(Terminal*)), Qt::UniqueConnection);
         // clang-format on
     }
 }
@@ -896,4 +932,130 @@ bool Session::wantsBlur() const
     return false;
 }
 
+QJsonObject Session::toJson()
+{
+    // Content is keyed by its widget, so the splitters can be walked once.
+    QHash<QWidget *, QJsonObject> contents;
+
+    for (auto &[id, terminal] : m_terminals) {
+        QJsonObject content;
+        content[QLatin1String("id")] = id;
+        content[QLatin1String("type")] = QStringLiteral("terminal");
+        content[QLatin1String("title")] = terminal->title();
+        content[QLatin1String("cwd")] = terminal->currentWorkingDirectory();
+        content[QLatin1String("closable")] = terminal->closable();
+        content[QLatin1String("keyboardInputEnabled")] = terminal->keyboardInputEnabled();
+        content[QLatin1String("monitorActivityEnabled")] = terminal->monitorActivityEnabled();
+        content[QLatin1String("monitorSilenceEnabled")] = terminal->monitorSilenceEnabled();
+
+        contents.insert(terminal->partWidget(), content);
+    }
+
+    for (auto &[id, browser] : m_browsers) {
+        QJsonObject content;
+        content[QLatin1String("id")] = id;
+        content[QLatin1String("type")] = QStringLiteral("browser");
+        content[QLatin1String("title")] = browser->title();
+        content[QLatin1String("url")] = browser->urlBar() ? browser->urlBar()->text() : QString();
+        content[QLatin1String("closable")] = browser->closable();
+
+        contents.insert(browser->partWidget(), content);
+    }
+
+    QJsonObject session;
+    session[QLatin1String("id")] = m_sessionId;
+    session[QLatin1String("type")] = (m_contentType == BrowserType) ? QStringLiteral("browser") : QStringLiteral("terminal");
+    session[QLatin1String("title")] = m_title;
+    session[QLatin1String("closable")] = m_closable;
+    session[QLatin1String("activeContentId")] = m_activeId;
+
+    if (m_baseSplitter)
+        session[QLatin1String("layout")] = splitterToJson(m_baseSplitter, contents);
+
+    return session;
+}
+
+QJsonObject Session::splitterToJson(QSplitter *splitter, const QHash<QWidget *, QJsonObject> &contents)
+{
+    QJsonArray children;
+
+    for (int i = 0; i < splitter->count(); ++i) {
+        QWidget *widget = splitter->widget(i);
+
+        if (auto *childSplitter = qobject_cast<QSplitter *>(widget))
+            children.append(splitterToJson(childSplitter, contents));
+        else if (contents.contains(widget))
+            children.append(contents.value(widget));
+    }
+
+    QJsonArray sizes;
+
+    const QList<int> splitterSizes = splitter->sizes();
+
+    for (int size : splitterSizes)
+        sizes.append(size);
+
+    QJsonObject node;
+    node[QLatin1String("orientation")] = (splitter->orientation() == Qt::Horizontal) ? QStringLiteral("horizontal") : QStringLiteral("vertical");
+    node[QLatin1String("sizes")] = sizes;
+    node[QLatin1String("children")] = children;
+
+    return node;
+}
+
+QList<int> Session::setupLayout(const SessionLayout::Node &layout)
+{
+    QList<int> ids;
+
+    if (layout.isTerminal()) {
+        setupLayoutTerminal(m_baseSplitter, layout, ids);
+        m_baseSplitter->setSizes(QList<int>() << 100);
+    } else {
+        setupLayoutSplitter(m_baseSplitter, layout, ids);
+    }
+
+    Terminal *terminal = getTerminal(ids.first());
+    QWidget *terminalWidget = terminal ? terminal->terminalWidget() : nullptr;
+
+    if (terminalWidget)
+        terminalWidget->setFocus();
+
+    setActiveId(ids.first());
+
+    return ids;
+}
+
+void Session::setupLayoutSplitter(Splitter *splitter, const SessionLayout::Node &node, QList<int> &ids)
+{
+    splitter->setOrientation(node.orientation);
+
+    for (const SessionLayout::Node &child : node.children) {
+        if (child.isTerminal()) {
+            setupLayoutTerminal(splitter, child, ids);
+        } else {
+            Splitter *childSplitter = new Splitter(Qt::Horizontal, splitter);
+            connect(childSplitter, SIGNAL(destroyed()), this, SLOT(cleanup()));
+
+            setupLayoutSplitter(childSplitter, child, ids);
+        }
+    }
+
+    splitter->setSizes(node.sizes);
+}
+
+void Session::setupLayoutTerminal(Splitter *splitter, const SessionLayout::Node &node, QList<int> &ids)
+{
+    Terminal *terminal = addTerminal(splitter, node.cwd);
+
+    if (!node.profile.isEmpty())
+        terminal->setProfile(node.profile);
+
+#if !defined(REMOVE_SENDTEXT_RUNCOMMAND_DBUS_METHODS)
+    if (!node.command.isEmpty())
+        terminal->runCommand(node.command);
+#endif
+
+    ids << terminal->id();
+}
+
 #include "moc_session.cpp"
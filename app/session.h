@@ -8,8 +8,11 @@
 #ifndef SESSION_H
 #define SESSION_H
 
+#include "sessionlayout.h"
 #include "splitter.h"
 
+#include <QHash>
+#include <QJsonObject>
 #include <QObject>
 
 class Terminal;
@@ -30,6 +33,7 @@ public:
         TwoHorizontal,
         TwoVertical,
         Quad,
+        Custom,
     };
     enum GrowthDirection {
         Up,
@@ -59,6 +63,7 @@ public:
         return m_activeId;
     }
     const QString terminalIdList();
+    QList<int> terminalIds() const;
     int terminalCount() const
     {
         return m_terminals.size();
@@ -106,6 +111,13 @@ public:
 
     bool wantsBlur() const;
 
+    // Describes the session's split tree and the state of its content.
+    QJsonObject toJson();
+
+    // Builds a parsed layout in a session created as Custom. Returns the ids
+    // of the new terminals.
+    QList<int> setupLayout(const SessionLayout::Node &layout);
+
 public Q_SLOTS:
     void closeSession(int id = -1);
 
@@ -126,7 +138,6 @@ public Q_SLOTS:
     void reconnectMonitorActivitySignals();
 
 Q_SIGNALS:
-    void titleChanged(const QString &title);
     void titleChanged(int sessionId, const QString &title);
     void terminalManuallyActivated(Terminal *terminal);
     void browserManuallyActivated(Browser *browser);
@@ -135,11 +146,16 @@ Q_SIGNALS:
     void silenceDetected(Session *session, int id);
     void destroyed(int sessionId);
     void wantsBlurChanged();
+    void contentChanged();
+    void activeIdChanged();
 
 private Q_SLOTS:
     void setActiveId(int Id);
     void setTitle(int Id, const QString &title);
 
+    void handleActivity(Terminal *terminal);
+    void handleSilence(Terminal *terminal);
+
     void cleanup(int Id);
     void cleanup();
     void prepareShutdown();
@@ -157,6 +173,9 @@ private:
     Browser *addBrowser(QSplitter *parent);
     int split(Terminal *terminal, Qt::Orientation orientation);
     int split(Browser *browser, Qt::Orientation orientation);
+    QJsonObject splitterToJson(QSplitter *splitter, const QHash<QWidget *, QJsonObject> &contents);
+    void setupLayoutSplitter(Splitter *splitter, const SessionLayout::Node &node, QList<int> &ids);
+    void setupLayoutTerminal(Splitter *splitter, const SessionLayout::Node &node, QList<int> &ids);
 
     QString m_workingDir;
     static int m_availableSessionId;
@@ -0,0 +1,48 @@
+/*
+  SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+  SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#ifndef SESSIONIDS_H
+#define SESSIONIDS_H
+
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+#include <algorithm>
+
+// The comma-separated id lists taken by the bulk D-Bus methods.
+namespace SessionIds
+{
+// Parses "3, 1,2" into its ids, in order. Returns false if an entry is not
+// an integer, so that a typo never turns into session 0.
+inline bool parse(const QString &idList, QList<int> &ids)
+{
+    const QStringList entries = idList.split(QLatin1Char(','), Qt::SkipEmptyParts);
+
+    ids.clear();
+    ids.reserve(entries.size());
+
+    for (const QString &entry : entries) {
+        bool ok = false;
+        const int id = entry.trimmed().toInt(&ok);
+
+        if (!ok)
+            return false;
+
+        ids << id;
+    }
+
+    return true;
+}
+
+// Whether order holds exactly the ids of current, each once.
+inline bool isPermutation(const QList<int> &order, const QList<int> &current)
+{
+    return order.size() == current.size() && std::is_permutation(order.cbegin(), order.cend(), current.cbegin());
+}
+}
+
+#endif
@@ -0,0 +1,106 @@
+/*
+  SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+  SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "sessionlayout.h"
+
+#include <QJsonArray>
+
+namespace SessionLayout
+{
+static bool parseNode(const QJsonObject &object, Node &node, int depth, int &terminals, bool allowCommands)
+{
+    if (depth > MaxDepth)
+        return false;
+
+    const QJsonArray children = object.value(QLatin1String("children")).toArray();
+
+    if (children.isEmpty()) {
+        if (++terminals > MaxTerminals)
+            return false;
+
+        node.cwd = object.value(QLatin1String("cwd")).toString();
+        node.profile = object.value(QLatin1String("profile")).toString();
+        node.command = object.value(QLatin1String("command")).toString();
+
+        return allowCommands || node.command.isEmpty();
+    }
+
+    if (object.value(QLatin1String("orientation")).toString() == QLatin1String("vertical"))
+        node.orientation = Qt::Vertical;
+
+    node.children.resize(children.count());
+
+    for (int i = 0; i < children.count(); ++i) {
+        if (!children.at(i).isObject())
+            return false;
+
+        if (!parseNode(children.at(i).toObject(), node.children[i], depth + 1, terminals, allowCommands))
+            return false;
+    }
+
+    // The sizes are taken as ratios; the splitter scales them to its size
+    // once it is laid out.
+    const QJsonArray ratios = object.value(QLatin1String("sizes")).toArray();
+
+    double total = 0;
+
+    for (const QJsonValue &ratio : ratios)
+        total += qMax(0.0, ratio.toDouble());
+
+    for (int i = 0; i < children.count(); ++i) {
+        if (ratios.count() == children.count() && total > 0)
+            node.sizes << qRound(qMax(0.0, ratios.at(i).toDouble()) * 1000 / total);
+        else
+            node.sizes << 1000 / children.count();
+    }
+
+    return true;
+}
+
+bool parse(const QJsonObject &object, Spec &spec, bool allowCommands)
+{
+    if (object.isEmpty())
+        return false;
+
+    const QJsonValue layout = object.value(QLatin1String("layout"));
+
+    if (!layout.isUndefined() && !layout.isObject())
+        return false;
+
+    spec.title = object.value(QLatin1String("title")).toString();
+    spec.root = Node();
+
+    int terminals = 0;
+
+    return parseNode(layout.isObject() ? layout.toObject() : object, spec.root, 1, terminals, allowCommands);
+}
+
+int terminalCount(const Node &node)
+{
+    if (node.isTerminal())
+        return 1;
+
+    int count = 0;
+
+    for (const Node &child : node.children)
+        count += terminalCount(child);
+
+    return count;
+}
+
+bool hasCommands(const Node &node)
+{
+    if (node.isTerminal())
+        return !node.command.isEmpty();
+
+    for (const Node &child : node.children) {
+        if (hasCommands(child))
+            return true;
+    }
+
+    return false;
+}
+}
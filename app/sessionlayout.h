@@ -0,0 +1,56 @@
+/*
+  SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+  SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#ifndef SESSIONLAYOUT_H
+#define SESSIONLAYOUT_H
+
+#include <QJsonObject>
+#include <QList>
+#include <QString>
+
+#include <vector>
+
+// The declarative session layout taken by SessionStack::addSessionFromLayout:
+// {"title": ..., "layout": node}, or a bare node, where a node is either a
+// splitter {"orientation", "sizes", "children"} or a terminal {"cwd",
+// "profile", "command"}. It is validated in full before any terminal is
+// created.
+namespace SessionLayout
+{
+static const int MaxDepth = 8;
+static const int MaxTerminals = 32;
+
+struct Node {
+    bool isTerminal() const
+    {
+        return children.empty();
+    }
+
+    // Splitter nodes; the sizes are the "sizes" ratios scaled to 1000.
+    Qt::Orientation orientation = Qt::Horizontal;
+    QList<int> sizes;
+    std::vector<Node> children;
+
+    // Terminal nodes.
+    QString cwd;
+    QString profile;
+    QString command;
+};
+
+struct Spec {
+    QString title;
+    Node root;
+};
+
+// Fails on anything but an object node, on nesting deeper than MaxDepth,
+// on more than MaxTerminals terminals, and on commands unless allowed.
+bool parse(const QJsonObject &object, Spec &spec, bool allowCommands);
+
+int terminalCount(const Node &node);
+bool hasCommands(const Node &node);
+}
+
+#endif
@@ -7,8 +7,12 @@
 
 #include "sessionstack.h"
 #include "browser.h"
+#include "contentregistry.h"
+#include "framescheduler.h"
 #include "session.h"
+#include "sessionids.h"
 #include "settings.h"
+#include "tabbar.h"
 #include "terminal.h"
 #include "visualeventoverlay.h"
 
@@ -17,16 +21,26 @@
 #include <KNotification>
 
 #include <QDBusConnection>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <QLineEdit>
 
 #include <algorithm>
+#include <utility>
 
 static bool show_disallow_certain_dbus_methods_message = true;
 
+static void warnAboutDBus();
+
 SessionStack::SessionStack(QWidget *parent)
     : QStackedWidget(parent)
     , m_visualEventOverlay(new VisualEventOverlay(this))
 {
+    QDBusConnection::sessionBus().registerObject(QStringLiteral("/yakuake/sessions"),
+                                                 this,
+                                                 QDBusConnection::ExportScriptableSlots | QDBusConnection::ExportScriptableSignals);
+
     connect(m_visualEventOverlay, &VisualEventOverlay::clicked, this, &SessionStack::removeTerminalHighlight);
 
     connect(this, SIGNAL(currentChanged(int)), this, SLOT(handleCurrentChanged(int)));
@@ -34,12 +48,18 @@ SessionStack::SessionStack(QWidget *parent)
     connect(this, SIGNAL(activityDetected(Session *, int)), this, SLOT(handleActivity(Session *, int)));
     connect(this, SIGNAL(silenceDetected(Session *, int)), this, SLOT(handleSilence(Session *, int)));
 
+    m_titleUpdateTimer.setSingleShot(true);
+    connect(&m_titleUpdateTimer, &QTimer::timeout, this, &SessionStack::flushTitleUpdates);
+
+    m_changeSignalTimer.setSingleShot(true);
+    connect(&m_changeSignalTimer, &QTimer::timeout, this, &SessionStack::flushChangeSignals);
+
     m_visualEventOverlay->hide();
 }
 
 SessionStack::~SessionStack() = default;
 
-int SessionStack::addSessionImpl(Session::SessionContent contentType, Session::SessionType type)
+int SessionStack::addSessionImpl(Session::SessionContent contentType, Session::SessionType type, const SessionLayout::Node &layout)
 {
     Session *currentSession = m_sessions.value(activeSessionId());
     QString workingDir;
@@ -49,16 +69,24 @@ int SessionStack::addSessionImpl(Session::SessionContent contentType, Session::S
     }
 
     Session *session = new Session(workingDir, contentType, type, this);
+
+    // A custom layout is built before the session is connected and shown,
+    // so it costs one relayout and no intermediate updates.
+    if (type == Session::Custom)
+        session->setupLayout(layout);
+
     // clang-format off
-    connect(session, SIGNAL(titleChanged(int,QString)), this, SIGNAL(titleChanged(int,QString)));
+    connect(session, SIGNAL(titleChanged(int,QString)), this, SLOT(queueTitleUpdate(int,QString)));
     connect(session, SIGNAL(destroyed(int)), this, SLOT(cleanup(int)));
     connect(session, &Session::wantsBlurChanged, this, &SessionStack::wantsBlurChanged);
+    connect(session, &Session::contentChanged, this, &SessionStack::notifyStructureChanged);
+    connect(session, &Session::activeIdChanged, this, &SessionStack::notifyFocusChanged);
 
     if (contentType == Session::TerminalType) {
         connect(session, SIGNAL(terminalManuallyActivated(Terminal*)), this, SLOT(handleManualActivation(Terminal*)));
         connect(session, SIGNAL(keyboardInputBlocked(Terminal*)), m_visualEventOverlay, SLOT(indicateKeyboardInputBlocked(QWidget*)));
-        connect(session, SIGNAL(activityDetected(Terminal*)), parentWidget(), SLOT(handleActivity(Session*,int)));
-        connect(session, SIGNAL(silenceDetected(Terminal*)), parentWidget(), SLOT(handleSilence(Session*,int)));
+        connect(session, SIGNAL(activityDetected(Session*,int)), this, SIGNAL(activityDetected(Session*,int)));
+        connect(session, SIGNAL(silenceDetected(Session*,int)), this, SIGNAL(silenceDetected(Session*,int)));
         connect(parentWidget(), SIGNAL(windowClosed()), session, SLOT(reconnectMonitorActivitySignals()));
     } else if (contentType == Session::BrowserType) {
         connect(session, SIGNAL(browserManuallyActivated(Browser*)), this, SLOT(handleManualActivation(Browser*)));
@@ -69,6 +97,7 @@ int SessionStack::addSessionImpl(Session::SessionContent contentType, Session::S
     session->widget()->updateGeometry();
 
     m_sessions.insert(session->id(), session);
+    m_deliveredTitles.insert(session->id(), session->title());
 
     Q_EMIT wantsBlurChanged();
 
@@ -77,6 +106,8 @@ int SessionStack::addSessionImpl(Session::SessionContent contentType, Session::S
     else
         Q_EMIT sessionAdded(session->id(), QString());
 
+    notifyStructureChanged();
+
     return session->id();
 }
 
@@ -105,6 +136,36 @@ int SessionStack::addTerminalSessionQuad()
     return addSessionImpl(Session::TerminalType, Session::Quad);
 }
 
+// Creates a terminal session from a declarative layout in one call; see
+// SessionLayout for the format. A "command" is refused when runCommand is
+// not exported. Returns the ids of the new terminals, or -1.
+QString SessionStack::addSessionFromLayout(const QString &layout)
+{
+#if defined(REMOVE_SENDTEXT_RUNCOMMAND_DBUS_METHODS)
+    const bool allowCommands = false;
+#else
+    const bool allowCommands = true;
+#endif
+
+    SessionLayout::Spec spec;
+
+    if (!SessionLayout::parse(QJsonDocument::fromJson(layout.toUtf8()).object(), spec, allowCommands))
+        return QString::number(-1);
+
+    if (SessionLayout::hasCommands(spec.root))
+        warnAboutDBus();
+
+    const int sessionId = addSessionImpl(Session::TerminalType, Session::Custom, spec.root);
+
+    // The title is set as interactive, like setTabTitle() over D-Bus does,
+    // so the terminal's own title does not replace it; sessionTree()
+    // reports it as tabTitleInteractive.
+    if (m_tabBar && !spec.title.isEmpty())
+        m_tabBar->setTabTitle(sessionId, spec.title, TabBar::Interactive);
+
+    return m_sessions.value(sessionId)->terminalIdList();
+}
+
 void SessionStack::raiseSession(int sessionId)
 {
     if (sessionId == -1 || !m_sessions.contains(sessionId))
@@ -120,7 +181,6 @@ void SessionStack::raiseSession(int sessionId)
         disconnect(oldActiveSession, SLOT(focusPrevious()));
         disconnect(oldActiveSession, SLOT(focusNext()));
         disconnect(oldActiveSession, SLOT(manageProfiles()));
-        disconnect(oldActiveSession, SIGNAL(titleChanged(QString)), this, SIGNAL(activeTitleChanged(QString)));
 
         if (oldActiveSession->contentType() == Session::TerminalType) {
             oldActiveSession->reconnectMonitorActivitySignals();
@@ -144,10 +204,11 @@ void SessionStack::raiseSession(int sessionId)
     connect(this, SIGNAL(previous()), session, SLOT(focusPrevious()));
     connect(this, SIGNAL(next()), session, SLOT(focusNext()));
     connect(this, SIGNAL(manageProfiles()), session, SLOT(manageProfiles()));
-    connect(session, SIGNAL(titleChanged(QString)), this, SIGNAL(activeTitleChanged(QString)));
 
     Q_EMIT sessionRaised(sessionId);
 
+    notifyFocusChanged();
+
     Q_EMIT activeTitleChanged(session->title());
 }
 
@@ -160,20 +221,57 @@ void SessionStack::removeSession(int sessionId)
     if (!m_sessions.contains(sessionId))
         return;
 
-    if (queryClose(sessionId, QueryCloseSession)) {
-        Session *session = m_sessions[sessionId];
+    if (queryClose(sessionId, QueryCloseSession))
+        destroySession(sessionId);
+}
 
-        m_sessions.remove(sessionId);
+// Closes a comma-separated list of sessions, asking at most once.
+void SessionStack::removeSessions(const QString &sessionIds)
+{
+    QList<int> ids;
 
-        removeWidget(session->widget());
+    if (SessionIds::parse(sessionIds, ids))
+        removeSessions(ids);
+}
 
-        Q_EMIT sessionRemoved(sessionId);
+void SessionStack::removeSessions(const QList<int> &sessionIds)
+{
+    QList<int> ids;
 
-        delete session;
+    for (int sessionId : sessionIds) {
+        if (m_sessions.contains(sessionId) && !ids.contains(sessionId))
+            ids << sessionId;
+    }
 
-        if (m_sessions.empty()) {
-            addTerminalSession();
-        }
+    if (ids.isEmpty())
+        return;
+
+    if (ids.count() == 1) {
+        removeSession(ids.first());
+        return;
+    }
+
+    if (!queryCloseSessions(ids))
+        return;
+
+    for (int sessionId : std::as_const(ids))
+        destroySession(sessionId);
+}
+
+void SessionStack::destroySession(int sessionId)
+{
+    Session *session = m_sessions[sessionId];
+
+    m_sessions.remove(sessionId);
+
+    removeWidget(session->widget());
+
+    Q_EMIT sessionRemoved(sessionId);
+
+    delete session;
+
+    if (m_sessions.empty()) {
+        addTerminalSession();
     }
 }
 
@@ -223,9 +321,47 @@ void SessionStack::cleanup(int sessionId)
         m_activeSessionId = -1;
 
     m_sessions.remove(sessionId);
+    m_pendingTitles.remove(sessionId);
+    m_deliveredTitles.remove(sessionId);
 
     Q_EMIT wantsBlurChanged();
     Q_EMIT sessionRemoved(sessionId);
+
+    notifyStructureChanged();
+}
+
+void SessionStack::queueTitleUpdate(int sessionId, const QString &title)
+{
+    m_pendingTitles.insert(sessionId, title);
+
+    if (m_titleUpdateTimer.isActive())
+        return;
+
+    // Deliver on the next frame boundary, so a terminal spamming its caption
+    // only costs one tab bar and title bar update per refresh.
+    m_titleUpdateTimer.start(FrameScheduler::self()->frameInterval(this));
+}
+
+void SessionStack::flushTitleUpdates()
+{
+    const QHash<int, QString> pendingTitles = std::exchange(m_pendingTitles, {});
+
+    for (auto it = pendingTitles.cbegin(); it != pendingTitles.cend(); ++it) {
+        if (!m_sessions.contains(it.key()))
+            continue;
+
+        auto delivered = m_deliveredTitles.find(it.key());
+
+        if (delivered != m_deliveredTitles.end() && *delivered == it.value())
+            continue;
+
+        m_deliveredTitles.insert(it.key(), it.value());
+
+        Q_EMIT titleChanged(it.key(), it.value());
+
+        if (it.key() == m_activeSessionId)
+            Q_EMIT activeTitleChanged(it.value());
+    }
 }
 
 int SessionStack::activeId()
@@ -274,29 +410,47 @@ const QString SessionStack::contentIdsForSessionId(int sessionId)
 
 int SessionStack::sessionIdForContentId(int contentId)
 {
-    int sessionId = -1;
+    Session *session = ContentRegistry::self()->session(contentId);
 
-    QHashIterator<int, Session *> it(m_sessions);
+    return session ? session->id() : -1;
+}
 
-    while (it.hasNext()) {
-        it.next();
+// Returns every session, in tab order when the tab bar is known, as one
+// compact JSON document, so scripts can take a snapshot in a single call.
+QString SessionStack::sessionTree()
+{
+    QList<int> sessionIds;
 
-        if (it.value()->contentType() == Session::TerminalType) {
-            if (it.value()->hasTerminal(contentId)) {
-                sessionId = it.key();
+    if (m_tabBar) {
+        for (int index = 0; m_tabBar->sessionAtTab(index) != -1; ++index)
+            sessionIds.append(m_tabBar->sessionAtTab(index));
+    } else {
+        sessionIds = m_sessions.keys();
+    }
 
-                break;
-            }
-        } else if (it.value()->contentType() == Session::BrowserType) {
-            if (it.value()->hasBrowser(contentId)) {
-                sessionId = it.key();
+    QJsonArray sessions;
 
-                break;
-            }
+    for (int sessionId : std::as_const(sessionIds)) {
+        Session *session = m_sessions.value(sessionId);
+
+        if (!session)
+            continue;
+
+        QJsonObject object = session->toJson();
+
+        if (m_tabBar) {
+            object[QLatin1String("tabTitle")] = m_tabBar->tabTitle(sessionId);
+            object[QLatin1String("tabTitleInteractive")] = m_tabBar->isTabTitleInteractive(sessionId);
         }
+
+        sessions.append(object);
     }
 
-    return sessionId;
+    QJsonObject tree;
+    tree[QLatin1String("activeSessionId")] = m_activeSessionId;
+    tree[QLatin1String("sessions")] = sessions;
+
+    return QString::fromUtf8(QJsonDocument(tree).toJson(QJsonDocument::Compact));
 }
 
 static void warnAboutDBus()
@@ -356,6 +510,58 @@ void SessionStack::runCommandInContent(int contentId, const QString &command)
     }
 }
 
+// Runs a command in several terminals with one call. The targets are "all",
+// "session:<id>" or a comma-separated list of content ids; the result holds
+// one "<id>:<status>" entry per target, the status being "ok", "unknown",
+// "not-terminal" or "failed". A session that does not exist yields the single
+// entry "session:<id>:unknown", malformed targets "<targets>:invalid"; no
+// command is run then.
+QStringList SessionStack::runCommandInContents(const QString &targets, const QString &command)
+{
+    warnAboutDBus();
+
+    QList<int> contentIds;
+
+    if (targets == QLatin1String("all")) {
+        for (Session *session : std::as_const(m_sessions))
+            contentIds << session->terminalIds();
+    } else if (targets.startsWith(QLatin1String("session:"))) {
+        bool ok = false;
+        const int sessionId = QStringView(targets).mid(8).trimmed().toInt(&ok);
+
+        if (!ok)
+            return {targets + QStringLiteral(":invalid")};
+
+        Session *session = m_sessions.value(sessionId, nullptr);
+
+        if (!session)
+            return {targets + QStringLiteral(":unknown")};
+
+        contentIds = session->terminalIds();
+    } else if (!SessionIds::parse(targets, contentIds)) {
+        return {targets + QStringLiteral(":invalid")};
+    }
+
+    QStringList results;
+    results.reserve(contentIds.size());
+
+    for (int contentId : std::as_const(contentIds)) {
+        const ContentRegistry::Entry entry = ContentRegistry::self()->entry(contentId);
+        QString status;
+
+        if (entry.terminal)
+            status = entry.terminal->runCommand(command) ? QStringLiteral("ok") : QStringLiteral("failed");
+        else if (entry.browser)
+            status = QStringLiteral("not-terminal");
+        else
+            status = QStringLiteral("unknown");
+
+        results << QString::number(contentId) + QLatin1Char(':') + status;
+    }
+
+    return results;
+}
+
 bool SessionStack::isSessionClosable(int sessionId)
 {
     if (sessionId == -1)
@@ -533,39 +739,20 @@ void SessionStack::setSessionMonitorActivityEnabled(int sessionId, bool enabled)
 
 bool SessionStack::isContentMonitorActivityEnabled(int contentId)
 {
-    QHashIterator<int, Session *> i(m_sessions);
-
-    while (i.hasNext()) {
-        i.next();
-
-        Session *session = i.value();
+    Session *session = ContentRegistry::self()->session(contentId);
 
-        if (session->contentType() == Session::TerminalType) {
-            if (session->hasTerminal(contentId)) {
-                return session->monitorActivityEnabled(contentId);
-            }
-        }
-    }
+    if (session && session->contentType() == Session::TerminalType)
+        return session->monitorActivityEnabled(contentId);
 
     return false;
 }
 
 void SessionStack::setContentMonitorActivityEnabled(int contentId, bool enabled)
 {
-    QHashIterator<int, Session *> i(m_sessions);
+    Session *session = ContentRegistry::self()->session(contentId);
 
-    while (i.hasNext()) {
-        i.next();
-
-        Session *session = i.value();
-
-        if (session->contentType() == Session::TerminalType) {
-            if (session->hasTerminal(contentId)) {
-                session->setMonitorActivityEnabled(contentId, enabled);
-                return;
-            }
-        }
-    }
+    if (session && session->contentType() == Session::TerminalType)
+        session->setMonitorActivityEnabled(contentId, enabled);
 }
 
 bool SessionStack::hasContentWithMonitorActivityEnabled(int sessionId)
@@ -633,39 +820,20 @@ void SessionStack::setSessionMonitorSilenceEnabled(int sessionId, bool enabled)
 
 bool SessionStack::isContentMonitorSilenceEnabled(int contentId)
 {
-    QHashIterator<int, Session *> i(m_sessions);
-
-    while (i.hasNext()) {
-        i.next();
+    Session *session = ContentRegistry::self()->session(contentId);
 
-        Session *session = i.value();
-
-        if (session->contentType() == Session::TerminalType) {
-            if (session->hasTerminal(contentId)) {
-                return session->monitorSilenceEnabled(contentId);
-            }
-        }
-    }
+    if (session && session->contentType() == Session::TerminalType)
+        return session->monitorSilenceEnabled(contentId);
 
     return false;
 }
 
 void SessionStack::setContentMonitorSilenceEnabled(int contentId, bool enabled)
 {
-    QHashIterator<int, Session *> i(m_sessions);
-
-    while (i.hasNext()) {
-        i.next();
+    Session *session = ContentRegistry::self()->session(contentId);
 
-        Session *session = i.value();
-
-        if (session->contentType() == Session::TerminalType) {
-            if (session->hasTerminal(contentId)) {
-                session->setMonitorSilenceEnabled(contentId, enabled);
-                return;
-            }
-        }
-    }
+    if (session && session->contentType() == Session::TerminalType)
+        session->setMonitorSilenceEnabled(contentId, enabled);
 }
 
 bool SessionStack::hasContentWithMonitorSilenceEnabled(int sessionId)
@@ -769,140 +937,62 @@ int SessionStack::splitSessionTopBottom(int sessionId)
 
 int SessionStack::splitContentLeftRight(int contentId)
 {
-    QHashIterator<int, Session *> i(m_sessions);
-
-    while (i.hasNext()) {
-        i.next();
+    Session *session = ContentRegistry::self()->session(contentId);
 
-        Session *session = i.value();
-
-        if (session->contentType() == Session::TerminalType) {
-            if (session->hasTerminal(contentId)) {
-                return session->splitLeftRight(contentId);
-            }
-        } else if (session->contentType() == Session::BrowserType) {
-            if (session->hasBrowser(contentId)) {
-                return session->splitLeftRight(contentId);
-            }
-        }
-    }
+    if (!session)
+        return -1;
 
-    return -1;
+    return session->splitLeftRight(contentId);
 }
 
 int SessionStack::splitContentTopBottom(int contentId)
 {
-    QHashIterator<int, Session *> i(m_sessions);
-
-    while (i.hasNext()) {
-        i.next();
-
-        Session *session = i.value();
+    Session *session = ContentRegistry::self()->session(contentId);
 
-        if (session->contentType() == Session::TerminalType) {
-            if (session->hasTerminal(contentId)) {
-                return session->splitTopBottom(contentId);
-            }
-        } else if (session->contentType() == Session::BrowserType) {
-            if (session->hasBrowser(contentId)) {
-                return session->splitTopBottom(contentId);
-            }
-        }
-    }
+    if (!session)
+        return -1;
 
-    return -1;
+    return session->splitTopBottom(contentId);
 }
 
 int SessionStack::tryGrowRight(int id, uint pixels)
 {
-    QHashIterator<int, Session *> i(m_sessions);
-
-    while (i.hasNext()) {
-        i.next();
+    Session *session = ContentRegistry::self()->session(id);
 
-        Session *session = i.value();
-
-        if (session->contentType() == Session::TerminalType) {
-            if (session->hasTerminal(id)) {
-                return session->tryGrow(id, Session::Right, pixels);
-            }
-        } else if (session->contentType() == Session::BrowserType) {
-            if (session->hasBrowser(id)) {
-                return session->tryGrow(id, Session::Right, pixels);
-            }
-        }
-    }
+    if (!session)
+        return -1;
 
-    return -1;
+    return session->tryGrow(id, Session::Right, pixels);
 }
 
 int SessionStack::tryGrowLeft(int id, uint pixels)
 {
-    QHashIterator<int, Session *> i(m_sessions);
-
-    while (i.hasNext()) {
-        i.next();
+    Session *session = ContentRegistry::self()->session(id);
 
-        Session *session = i.value();
-
-        if (session->contentType() == Session::TerminalType) {
-            if (session->hasTerminal(id)) {
-                return session->tryGrow(id, Session::Left, pixels);
-            }
-        } else if (session->contentType() == Session::BrowserType) {
-            if (session->hasBrowser(id)) {
-                return session->tryGrow(id, Session::Left, pixels);
-            }
-        }
-    }
+    if (!session)
+        return -1;
 
-    return -1;
+    return session->tryGrow(id, Session::Left, pixels);
 }
 
 int SessionStack::tryGrowTop(int id, uint pixels)
 {
-    QHashIterator<int, Session *> i(m_sessions);
-
-    while (i.hasNext()) {
-        i.next();
-
-        Session *session = i.value();
+    Session *session = ContentRegistry::self()->session(id);
 
-        if (session->contentType() == Session::TerminalType) {
-            if (session->hasTerminal(id)) {
-                return session->tryGrow(id, Session::Up, pixels);
-            }
-        } else if (session->contentType() == Session::BrowserType) {
-            if (session->hasBrowser(id)) {
-                return session->tryGrow(id, Session::Up, pixels);
-            }
-        }
-    }
+    if (!session)
+        return -1;
 
-    return -1;
+    return session->tryGrow(id, Session::Up, pixels);
 }
 
 int SessionStack::tryGrowBottom(int id, uint pixels)
 {
-    QHashIterator<int, Session *> i(m_sessions);
-
-    while (i.hasNext()) {
-        i.next();
+    Session *session = ContentRegistry::self()->session(id);
 
-        Session *session = i.value();
-
-        if (session->contentType() == Session::TerminalType) {
-            if (session->hasTerminal(id)) {
-                return session->tryGrow(id, Session::Down, pixels);
-            }
-        } else if (session->contentType() == Session::BrowserType) {
-            if (session->hasBrowser(id)) {
-                return session->tryGrow(id, Session::Down, pixels);
-            }
-        }
-    }
+    if (!session)
+        return -1;
 
-    return -1;
+    return session->tryGrow(id, Session::Down, pixels);
 }
 
 void SessionStack::emitTitles()
@@ -916,6 +1006,9 @@ void SessionStack::emitTitles()
 
         title = it.value()->title();
 
+        m_pendingTitles.remove(it.key());
+        m_deliveredTitles.insert(it.key(), title);
+
         if (!title.isEmpty())
             Q_EMIT titleChanged(it.value()->id(), title);
     }
@@ -937,27 +1030,16 @@ bool SessionStack::requiresVisualEventOverlay()
 
 void SessionStack::handleHighlightRequest(int id)
 {
-    QHashIterator<int, Session *> i(m_sessions);
+    const ContentRegistry::Entry entry = ContentRegistry::self()->entry(id);
 
-    while (i.hasNext()) {
-        i.next();
-
-        Session *session = i.value();
+    if (entry.terminal)
+        m_visualEventOverlay->highlightContent(entry.terminal->partWidget(), true);
+    else if (entry.browser)
+        m_visualEventOverlay->highlightContent(entry.browser->partWidget(), true);
+    else
+        return;
 
-        if (session->contentType() == Session::TerminalType) {
-            if (session->hasTerminal(id)) {
-                m_visualEventOverlay->highlightContent(session->getTerminal(id)->partWidget(), true);
-                m_visualEventOverlay->show();
-                return;
-            }
-        } else if (session->contentType() == Session::BrowserType) {
-            if (session->hasBrowser(id)) {
-                m_visualEventOverlay->highlightContent(session->getBrowser(id)->partWidget(), true);
-                m_visualEventOverlay->show();
-                return;
-            }
-        }
-    }
+    m_visualEventOverlay->show();
 }
 
 void SessionStack::showEvent(QShowEvent *event)
@@ -987,16 +1069,92 @@ void SessionStack::handleCurrentChanged(int index)
     // TODO: Implement logic for when the current session changes
 }
 
-void SessionStack::handleActivity(Terminal *terminal)
+void SessionStack::handleActivity(Session *session, int id)
+{
+    Q_UNUSED(session);
+
+    m_activityContentIds.insert(id);
+
+    scheduleChangeSignals();
+}
+
+void SessionStack::handleSilence(Session *session, int id)
+{
+    Q_UNUSED(session);
+
+    m_silenceContentIds.insert(id);
+
+    scheduleChangeSignals();
+}
+
+void SessionStack::notifyStructureChanged()
 {
-    Q_UNUSED(terminal);
-    // TODO: Implement logic for activity detection
+    m_structureChanged = true;
+
+    scheduleChangeSignals();
 }
 
-void SessionStack::handleSilence(Terminal *terminal)
+void SessionStack::notifyTitleChanged(int sessionId)
 {
-    Q_UNUSED(terminal);
-    // TODO: Implement logic for silence detection
+    m_changedTitles.insert(sessionId);
+
+    scheduleChangeSignals();
+}
+
+void SessionStack::notifyFocusChanged()
+{
+    m_focusChanged = true;
+
+    scheduleChangeSignals();
+}
+
+void SessionStack::scheduleChangeSignals()
+{
+    if (m_changeSignalTimer.isActive())
+        return;
+
+    m_changeSignalTimer.start(FrameScheduler::self()->frameInterval(this));
+}
+
+void SessionStack::flushChangeSignals()
+{
+    if (std::exchange(m_structureChanged, false))
+        Q_EMIT structureChanged();
+
+    const QSet<int> changedTitles = std::exchange(m_changedTitles, {});
+
+    for (int sessionId : changedTitles) {
+        Session *session = m_sessions.value(sessionId);
+
+        if (session)
+            Q_EMIT sessionTitleChanged(sessionId, m_tabBar ? m_tabBar->tabTitle(sessionId) : session->title());
+    }
+
+    if (std::exchange(m_focusChanged, false)) {
+        const int contentId = activeId();
+
+        if (m_activeSessionId != m_deliveredFocusSessionId || contentId != m_deliveredFocusContentId) {
+            m_deliveredFocusSessionId = m_activeSessionId;
+            m_deliveredFocusContentId = contentId;
+
+            Q_EMIT focusChanged(m_activeSessionId, contentId);
+        }
+    }
+
+    // Content that went away before the flush is skipped.
+    const QSet<int> activityContentIds = std::exchange(m_activityContentIds, {});
+
+    for (int contentId : activityContentIds) {
+        if (Session *session = ContentRegistry::self()->session(contentId))
+            Q_EMIT contentActivityDetected(session->id(), contentId);
+    }
+
+    const QSet<int> silenceContentIds = std::exchange(m_silenceContentIds, {});
+
+    for (int contentId : silenceContentIds) {
+        if (Session *session = ContentRegistry::self()->session(contentId))
+            Q_EMIT contentSilenceDetected(session->id(), contentId);
+    }
 }
 
 void SessionStack::handleManualActivation(Terminal *terminal)
@@ -1016,6 +1174,57 @@ void SessionStack::handleManualActivation(Browser *browser)
     // No highlight for browser for now
 }
 
+// Asks once for a set of sessions, on the same grounds queryClose() asks for
+// a single one: locked sessions, or sessions with several terminals or
+// browser tabs when confirmQuit is set.
+bool SessionStack::queryCloseSessions(const QList<int> &sessionIds)
+{
+    const bool confirmQuit = Settings::confirmQuit();
+    bool hasUnclosableSessions = false;
+    bool hasMultipleContents = false;
+
+    for (int sessionId : sessionIds) {
+        Session *session = m_sessions.value(sessionId);
+
+        if (!session->closable())
+            hasUnclosableSessions = true;
+
+        if ((session->contentType() == Session::TerminalType && session->terminalCount() > 1)
+            || (session->contentType() == Session::BrowserType && session->browserCount() > 1))
+            hasMultipleContents = true;
+    }
+
+    if (!hasUnclosableSessions && !(confirmQuit && hasMultipleContents))
+        return true;
+
+    const QString closeQuestion =
+        xi18ncp("@info", "Are you sure you want to close this session?", "Are you sure you want to close these %1 sessions?", sessionIds.count());
+    QString warningMessage;
+
+    if (confirmQuit && hasMultipleContents) {
+        if (hasUnclosableSessions)
+            warningMessage = xi18nc("@info",
+                                    "<warning>Some of these sessions hold multiple terminals or browser tabs, <emphasis>some of which you have locked to "
+                                    "prevent closing them accidentally.</emphasis> These will be killed if you continue.</warning>");
+        else
+            warningMessage = xi18nc(
+                "@info",
+                "<warning>Some of these sessions hold multiple terminals or browser tabs. These will be killed if you continue.</warning>");
+    } else {
+        warningMessage = xi18nc("@info",
+                                "<warning>Some of these sessions hold terminals or browser tabs that you have locked to prevent closing them "
+                                "accidentally. These will be killed if you continue.</warning>");
+    }
+
+    int result = KMessageBox::warningContinueCancel(this,
+                                                    warningMessage + QStringLiteral("<br /><br />") + closeQuestion,
+                                                    xi18ncp("@title:window", "Really Close Session?", "Really Close Sessions?", sessionIds.count()),
+                                                    KStandardGuiItem::close(),
+                                                    KStandardGuiItem::cancel());
+
+    return result != KMessageBox::Cancel;
+}
+
 bool SessionStack::queryClose(int sessionId, QueryCloseType type)
 {
     if (!m_sessions.contains(sessionId))
@@ -13,9 +13,13 @@
 #include <config-yakuake.h>
 
 #include <QHash>
+#include <QSet>
 #include <QStackedWidget>
+#include <QStringList>
+#include <QTimer>
 
 class Session;
+class TabBar;
 class Terminal;
 class Browser;
 class KActionCollection;
@@ -41,22 +45,33 @@ public:
     QList<KActionCollection *> getPartActionCollections();
 
     bool wantsBlur() const;
+
+    void setTabBar(TabBar *tabBar)
+    {
+        m_tabBar = tabBar;
+    }
+
     Session *session(int sessionId) const
     {
         return m_sessions.value(sessionId);
     }
 
 public Q_SLOTS:
-    int addSessionImpl(Session::SessionContent contentType, Session::SessionType type = Session::Single);
+    int addSessionImpl(Session::SessionContent contentType,
+                       Session::SessionType type = Session::Single,
+                       const SessionLayout::Node &layout = SessionLayout::Node());
     void addTerminalSession();
     void addBrowserSession();
     Q_SCRIPTABLE int addTerminalSessionTwoHorizontal();
     Q_SCRIPTABLE int addTerminalSessionTwoVertical();
     Q_SCRIPTABLE int addTerminalSessionQuad();
+    Q_SCRIPTABLE QString addSessionFromLayout(const QString &layout);
 
     Q_SCRIPTABLE void raiseSession(int sessionId);
 
     Q_SCRIPTABLE void removeSession(int sessionId);
+    Q_SCRIPTABLE void removeSessions(const QString &sessionIds);
+    void removeSessions(const QList<int> &sessionIds);
     Q_SCRIPTABLE void removeContent(int contentId);
 
     Q_SCRIPTABLE int splitSessionAuto(int sessionId);
@@ -81,12 +96,16 @@ public Q_SLOTS:
     Q_SCRIPTABLE const QString contentIdsForSessionId(int sessionId);
     Q_SCRIPTABLE int sessionIdForContentId(int contentId);
 
+    Q_SCRIPTABLE QString sessionTree();
+
 #if defined(REMOVE_SENDTEXT_RUNCOMMAND_DBUS_METHODS)
     void runCommand(const QString &command);
+    QStringList runCommandInContents(const QString &targets, const QString &command);
 #else
     Q_SCRIPTABLE void runCommand(const QString &command);
     Q_SCRIPTABLE void runCommandInTerminal(int terminalId, const QString &command);
     Q_SCRIPTABLE void runCommandInContent(int contentId, const QString &command);
+    Q_SCRIPTABLE QStringList runCommandInContents(const QString &targets, const QString &command);
 #endif
 
     Q_SCRIPTABLE bool isSessionClosable(int sessionId);
@@ -116,6 +135,9 @@ public Q_SLOTS:
 
     void handleHighlightRequest(int id);
 
+    void notifyStructureChanged();
+    void notifyTitleChanged(int sessionId);
+
 Q_SIGNALS:
     void sessionAdded(int sessionId, const QString &title);
     void sessionRaised(int sessionId);
@@ -136,16 +158,30 @@ Q_SIGNALS:
 
     void wantsBlurChanged();
 
+    // Exported on D-Bus, and delivered at most once per frame each.
+    Q_SCRIPTABLE void structureChanged();
+    Q_SCRIPTABLE void sessionTitleChanged(int sessionId, const QString &title);
+    Q_SCRIPTABLE void focusChanged(int sessionId, int contentId);
+    Q_SCRIPTABLE void contentActivityDetected(int sessionId, int contentId);
+    Q_SCRIPTABLE void contentSilenceDetected(int sessionId, int contentId);
+
 protected:
     void showEvent(QShowEvent *event) override;
 
 private Q_SLOTS:
     void handleCurrentChanged(int index);
-    void handleActivity(Terminal *terminal);
-    void handleSilence(Terminal *terminal);
+    void handleActivity(Session *session, int id);
+    void handleSilence(Session *session, int id);
     void handleManualActivation(Terminal *terminal);
     void handleManualActivation(Browser *browser);
 
+    void queueTitleUpdate(int sessionId, const QString &title);
+    void flushTitleUpdates();
+
+    void notifyFocusChanged();
+    void scheduleChangeSignals();
+    void flushChangeSignals();
+
     void cleanup(int sessionId);
 
 private:
@@ -155,12 +191,29 @@ private:
         QueryCloseBrowser,
     };
     bool queryClose(int sessionId, QueryCloseType type);
+    bool queryCloseSessions(const QList<int> &sessionIds);
+    void destroySession(int sessionId);
 
     VisualEventOverlay *m_visualEventOverlay;
+    TabBar *m_tabBar = nullptr;
 
     int m_activeSessionId;
 
     QHash<int, Session *> m_sessions;
+
+    // Title changes are coalesced to at most one delivery per session per frame.
+    QTimer m_titleUpdateTimer;
+    QHash<int, QString> m_pendingTitles;
+    QHash<int, QString> m_deliveredTitles;
+
+    QTimer m_changeSignalTimer;
+    bool m_structureChanged = false;
+    QSet<int> m_changedTitles;
+    bool m_focusChanged = false;
+    int m_deliveredFocusSessionId = -1;
+    int m_deliveredFocusContentId = -1;
+    QSet<int> m_activityContentIds;
+    QSet<int> m_silenceContentIds;
 };
 
 #endif
@@ -5,85 +5,663 @@
 */
 
 #include "skin.h"
+#include "defaultskinmetrics.h"
+#include "skinpackage.h"
+#include "yakuake_debug.h"
 
 #include <KConfig>
+#include <KColorScheme>
 #include <KConfigGroup>
 #include <KIconLoader>
+#include <KLocalizedString>
 
+#include <QApplication>
+#include <QColor>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
 #include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QFontMetrics>
 #include <QIcon>
+#include <QImage>
+#include <QImageReader>
+#include <QPainter>
+#include <QSaveFile>
+#include <QSharedPointer>
+#include <QStandardPaths>
+#include <QSvgRenderer>
+#include <QThreadPool>
+#include <QTransform>
+#include <QtMath>
+#include <QtEndian>
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <memory>
+#include <utility>
 
 Skin::Skin()
 {
     m_borderWidth = 0;
+
+    // Editors tend to write files in several steps, wait for them to settle.
+    m_reloadTimer.setSingleShot(true);
+    m_reloadTimer.setInterval(250);
+    connect(&m_reloadTimer, &QTimer::timeout, this, &Skin::reloadChangedFiles);
+}
+
+Skin::~Skin()
+{
+    // A pending decode posts back to this object.
+    m_decodePool.waitForDone();
+}
+
+static const quint32 CacheMagic = 0x59534b43; // "YSKC"
+static const quint32 CacheVersion = 5;
+static const qint64 CacheAlignment = 64;
+
+// How long opening the window may wait for a skin to be decoded again, in ms.
+static const int RestoreDecodeTimeout = 100;
+
+static qint64 alignedCacheOffset(qint64 offset)
+{
+    return (offset + CacheAlignment - 1) & ~(CacheAlignment - 1);
+}
+
+static qint64 lastModified(const QString &path)
+{
+    if (path.isEmpty())
+        return 0;
+
+    const QFileInfo info(path);
+
+    return info.exists() ? info.lastModified().toMSecsSinceEpoch() : -1;
+}
+
+// The default skin is compiled in; its descriptors are turned into tables at
+// build time, so that loading it neither looks up nor parses any file. A
+// "default" skin directory in the data locations still takes precedence.
+static const QString BuiltinSkinDir = QStringLiteral(":/yakuake/skins/default");
+
+// The colour scheme skin has no images; its elements are drawn from the
+// current KColorScheme. Only its descriptors, for the skin list, are
+// compiled in.
+static const QString ColorSchemeSkinDir = QStringLiteral(":/yakuake/skins/colorscheme");
+
+namespace
+{
+// A group of a skin descriptor, read through KConfig or from one of the
+// generated tables.
+class SkinConfigGroup
+{
+public:
+    explicit SkinConfigGroup(const KConfigGroup &group)
+        : m_group(group)
+    {
+    }
+
+    SkinConfigGroup(const SkinMetricsEntry *begin, const SkinMetricsEntry *end, const QString &name)
+        : m_begin(begin)
+        , m_end(end)
+        , m_name(name.toLatin1())
+    {
+    }
+
+    QString readEntry(const char *key, const QString &defaultValue) const
+    {
+        if (!m_begin)
+            return m_group.readEntry(key, defaultValue);
+
+        const char *entry = value(key);
+
+        return entry ? QString::fromUtf8(entry) : defaultValue;
+    }
+
+    QString readEntry(const char *key, const char *defaultValue) const
+    {
+        return readEntry(key, QString::fromUtf8(defaultValue));
+    }
+
+    int readEntry(const char *key, int defaultValue) const
+    {
+        if (!m_begin)
+            return m_group.readEntry(key, defaultValue);
+
+        bool ok = false;
+        const int entry = QByteArray(value(key)).toInt(&ok);
+
+        return ok ? entry : defaultValue;
+    }
+
+    bool readEntry(const char *key, bool defaultValue) const
+    {
+        if (!m_begin)
+            return m_group.readEntry(key, defaultValue);
+
+        const QByteArray entry = QByteArray(value(key)).toLower();
+
+        if (entry == "true" || entry == "on" || entry == "yes" || entry == "1")
+            return true;
+        else if (entry == "false" || entry == "off" || entry == "no" || entry == "0")
+            return false;
+
+        return defaultValue;
+    }
+
+private:
+    const char *value(const char *key) const
+    {
+        for (const SkinMetricsEntry *entry = m_begin; entry != m_end; ++entry) {
+            if (m_name == entry->group && qstrcmp(key, entry->key) == 0)
+                return entry->value;
+        }
+
+        return nullptr;
+    }
+
+    KConfigGroup m_group;
+
+    const SkinMetricsEntry *m_begin = nullptr;
+    const SkinMetricsEntry *m_end = nullptr;
+    QByteArray m_name;
+};
+
+class SkinConfig
+{
+public:
+    explicit SkinConfig(const QString &path)
+    {
+        if (path == BuiltinSkinDir + QStringLiteral("/title.skin")) {
+            m_begin = std::begin(defaultSkinTitleMetrics);
+            m_end = std::end(defaultSkinTitleMetrics);
+        } else if (path == BuiltinSkinDir + QStringLiteral("/tabs.skin")) {
+            m_begin = std::begin(defaultSkinTabsMetrics);
+            m_end = std::end(defaultSkinTabsMetrics);
+        } else {
+            m_config = std::make_unique<KConfig>(path, KConfig::SimpleConfig);
+        }
+    }
+
+    SkinConfigGroup group(const QString &name) const
+    {
+        if (m_config)
+            return SkinConfigGroup(m_config->group(name));
+
+        return SkinConfigGroup(m_begin, m_end, name);
+    }
+
+private:
+    std::unique_ptr<KConfig> m_config;
+
+    const SkinMetricsEntry *m_begin = nullptr;
+    const SkinMetricsEntry *m_end = nullptr;
+};
 }
 
-Skin::~Skin() = default;
+static QString imagePath(const QString &dir, const SkinConfigGroup &group, const char *key)
+{
+    const QString file = group.readEntry(key, QString());
+
+    return file.isEmpty() ? QString() : dir + file;
+}
+
+// Vector images are rendered at their default size times the device pixel
+// ratio, bitmaps are scaled up once here instead of on every draw. Integer
+// ratios keep the pixels sharp, fractional ones are filtered, as QPainter
+// would when scaling on the fly.
+static QImage decodeImage(const QString &file, qreal dpr)
+{
+    if (file.endsWith(QLatin1String(".svg"), Qt::CaseInsensitive) || file.endsWith(QLatin1String(".svgz"), Qt::CaseInsensitive)) {
+        QSvgRenderer renderer(file);
+
+        if (!renderer.isValid() || renderer.defaultSize().isEmpty())
+            return QImage();
+
+        QImage image((QSizeF(renderer.defaultSize()) * dpr).toSize(), QImage::Format_ARGB32_Premultiplied);
+        image.fill(Qt::transparent);
+
+        QPainter painter(&image);
+        renderer.render(&painter);
+        painter.end();
+
+        image.setDevicePixelRatio(dpr);
+
+        return image;
+    }
+
+    QImage image = QImageReader(file).read();
+
+    if (image.isNull())
+        return image;
+
+    const QImage::Format format = image.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32;
+    image = std::move(image).convertToFormat(format);
+
+    if (!qFuzzyCompare(dpr, qreal(1.0))) {
+        const Qt::TransformationMode mode = qFuzzyCompare(dpr, std::round(dpr)) ? Qt::FastTransformation : Qt::SmoothTransformation;
+
+        image = image.scaled((QSizeF(image.size()) * dpr).toSize(), Qt::IgnoreAspectRatio, mode);
+        image.setDevicePixelRatio(dpr);
+    }
+
+    return image;
+}
+
+// Decodes the skin images on a thread pool. Files referenced by more than one
+// element are only read once; the results are left as QImage so that the
+// pixmap conversion happens on the GUI thread.
+static std::array<QImage, Skin::ElementCount> decodeImages(const std::array<QString, Skin::ElementCount> &paths, qreal dpr)
+{
+    QStringList files;
+    std::array<int, Skin::ElementCount> fileIndex;
+
+    for (int i = 0; i < Skin::ElementCount; ++i) {
+        fileIndex[i] = -1;
+
+        if (paths[i].isEmpty())
+            continue;
+
+        fileIndex[i] = files.indexOf(paths[i]);
+
+        if (fileIndex[i] == -1) {
+            fileIndex[i] = files.size();
+            files.append(paths[i]);
+        }
+    }
+
+    QList<QImage> decoded(files.size());
+    QImage *results = decoded.data();
+
+    QThreadPool pool;
+
+    for (int i = 0; i < files.size(); ++i) {
+        const QString file = files.at(i);
+
+        pool.start([file, dpr, results, i]() {
+            results[i] = decodeImage(file, dpr);
+        });
+    }
+
+    pool.waitForDone();
+
+    std::array<QImage, Skin::ElementCount> images;
+
+    for (int i = 0; i < Skin::ElementCount; ++i) {
+        if (fileIndex[i] != -1)
+            images[i] = decoded.at(fileIndex[i]);
+    }
+
+    return images;
+}
 
-bool Skin::load(const QString &name, bool kns)
+bool Skin::load(const QString &name, bool kns, qreal devicePixelRatio)
 {
     const QString dir = kns ? QStringLiteral("kns_skins/") : QStringLiteral("skins/");
 
-    const QString titlePath = QStandardPaths::locate(QStandardPaths::AppDataLocation, dir + name + QStringLiteral("/title.skin"));
-    const QString tabPath = QStandardPaths::locate(QStandardPaths::AppDataLocation, dir + name + QStringLiteral("/tabs.skin"));
+    QString titlePath;
+    QString tabPath;
+
+    std::unique_ptr<SkinPackage> package;
+    bool colorScheme = false;
+
+    if (!kns && name == QLatin1String("default")) {
+        // One lookup for an override; its tabs.skin has to sit next to it.
+        titlePath = QStandardPaths::locate(QStandardPaths::AppDataLocation, dir + name + QStringLiteral("/title.skin"));
+
+        if (!titlePath.isEmpty())
+            tabPath = QFileInfo(titlePath).absolutePath() + QStringLiteral("/tabs.skin");
+
+        if (titlePath.isEmpty() || !QFile::exists(tabPath)) {
+            titlePath = BuiltinSkinDir + QStringLiteral("/title.skin");
+            tabPath = BuiltinSkinDir + QStringLiteral("/tabs.skin");
+        }
+    } else {
+        titlePath = QStandardPaths::locate(QStandardPaths::AppDataLocation, dir + name + QStringLiteral("/title.skin"));
+        tabPath = QStandardPaths::locate(QStandardPaths::AppDataLocation, dir + name + QStringLiteral("/tabs.skin"));
+    }
+
+    if ((titlePath.isEmpty() || tabPath.isEmpty()) && !kns && name == QLatin1String("colorscheme")) {
+        titlePath = ColorSchemeSkinDir + QStringLiteral("/title.skin");
+        tabPath = ColorSchemeSkinDir + QStringLiteral("/tabs.skin");
+        colorScheme = true;
+    } else if (titlePath.isEmpty() || tabPath.isEmpty()) {
+        const QString packagePath = QStandardPaths::locate(QStandardPaths::AppDataLocation, dir + name + QStringLiteral(".rcc"));
+
+        if (packagePath.isEmpty())
+            return false;
+
+        // Reloading the same package, e.g. for a new device pixel ratio,
+        // keeps it mounted where it is.
+        if (m_package && m_package->path() == packagePath && lastModified(packagePath) == m_packageModified) {
+            package = std::move(m_package);
+        } else {
+            package = std::make_unique<SkinPackage>(packagePath);
+
+            if (!package->isValid())
+                return false;
+        }
+
+        titlePath = package->root() + QLatin1Char('/') + name + QStringLiteral("/title.skin");
+        tabPath = package->root() + QLatin1Char('/') + name + QStringLiteral("/tabs.skin");
+    }
 
     if (!QFile::exists(titlePath) || !QFile::exists(tabPath))
         return false;
 
+    // Whatever was decoded from a previous package is owned by the pixmaps
+    // and caches by now, so it can go.
+    m_package = std::move(package);
+    m_packageModified = m_package ? lastModified(m_package->path()) : 0;
+
     connect(KIconLoader::global(), SIGNAL(iconChanged(int)), this, SLOT(systemIconsChanged(int)), Qt::UniqueConnection);
 
+    m_devicePixelRatio = devicePixelRatio;
+    m_titlePath = titlePath;
+    m_tabPath = tabPath;
+
+    m_colorScheme = colorScheme;
+    m_cachesReleased = false;
+    ++m_decodeGeneration;
+
+    // The compiled-in skins need no cache: their metrics are generated at
+    // build time and their images are vector images in the binary.
+    const QString cachePath = isCompiledIn() ? QString() : cacheFilePath(titlePath, tabPath, m_devicePixelRatio);
+
+    if (m_colorScheme)
+        renderColorScheme();
+    else if (!cachePath.isEmpty() && loadCache(cachePath, titlePath, tabPath, m_devicePixelRatio))
+        qCDebug(YAKUAKE_LOG) << "Loaded skin" << name << "from" << cachePath;
+    else
+        loadFiles(cachePath, titlePath, tabPath, m_devicePixelRatio);
+
+    updateElements();
+
+    updateWatcher();
+
+    qCDebug(YAKUAKE_LOG) << "Skin" << name << "holds" << residentBytes() << "bytes";
+
+    return true;
+}
+
+void Skin::setWatchFiles(bool watch)
+{
+    if (watch == (m_watcher != nullptr))
+        return;
+
+    if (watch) {
+        m_watcher = new QFileSystemWatcher(this);
+        connect(m_watcher, &QFileSystemWatcher::fileChanged, &m_reloadTimer, qOverload<>(&QTimer::start));
+        connect(m_watcher, &QFileSystemWatcher::directoryChanged, &m_reloadTimer, qOverload<>(&QTimer::start));
+
+        updateWatcher();
+    } else {
+        delete m_watcher;
+        m_watcher = nullptr;
+
+        m_reloadTimer.stop();
+        m_fileModified.clear();
+    }
+}
+
+// Watches the skin files as well as their directories, as editors often
+// replace a file rather than write to it, which drops the file watch.
+void Skin::updateWatcher()
+{
+    if (!m_watcher)
+        return;
+
+    QStringList files = {m_titlePath, m_tabPath};
+
+    for (const QString &path : std::as_const(m_elementPaths)) {
+        if (!path.isEmpty() && !files.contains(path))
+            files.append(path);
+    }
+
+    // Files inside a package can't be watched, the package itself is.
+    if (m_package)
+        files.append(m_package->path());
+
+    QStringList paths;
+    m_fileModified.clear();
+
+    for (const QString &file : std::as_const(files)) {
+        m_fileModified.insert(file, lastModified(file));
+
+        if (m_fileModified.value(file) == -1 || file.startsWith(QLatin1Char(':')))
+            continue;
+
+        const QString dir = QFileInfo(file).absolutePath();
+
+        if (!paths.contains(dir))
+            paths.append(dir);
+
+        paths.append(file);
+    }
+
+    const QStringList watched = m_watcher->files() + m_watcher->directories();
+
+    if (!watched.isEmpty())
+        m_watcher->removePaths(watched);
+
+    if (!paths.isEmpty())
+        m_watcher->addPaths(paths);
+}
+
+bool Skin::isCompiledIn() const
+{
+    return m_titlePath.startsWith(BuiltinSkinDir) || m_titlePath.startsWith(ColorSchemeSkinDir);
+}
+
+Skin::Section Skin::elementSection(Element element)
+{
+    return element < TabBarSeparator ? TitleBarSection : TabBarSection;
+}
+
+// Reloads what changed on disk since the skin was loaded: the configs are
+// re-read, but only images whose path or modification time changed are
+// decoded again. Those that keep their size are patched into the atlas in
+// place.
+void Skin::reloadChangedFiles()
+{
+    // The next load() reads the files anyway.
+    if (m_cachesReleased)
+        return;
+
+    Sections sections;
+
+    // A replaced package is mounted anew; as all paths then change, every
+    // element is decoded again.
+    if (m_package && lastModified(m_package->path()) != m_packageModified) {
+        auto package = std::make_unique<SkinPackage>(m_package->path());
+
+        // Most likely still being written, the watcher will fire again.
+        if (!package->isValid() || package->skinId().isEmpty())
+            return;
+
+        m_titlePath.replace(0, m_package->root().size(), package->root());
+        m_tabPath.replace(0, m_package->root().size(), package->root());
+
+        m_package = std::move(package);
+        m_packageModified = lastModified(m_package->path());
+
+        sections |= TitleBarSection | TabBarSection;
+    }
+
+    if (lastModified(m_titlePath) != m_fileModified.value(m_titlePath))
+        sections |= TitleBarSection;
+
+    if (lastModified(m_tabPath) != m_fileModified.value(m_tabPath))
+        sections |= TabBarSection;
+
+    const std::array<QString, ElementCount> oldPaths = m_elementPaths;
+    const QColor oldBorderColor = m_borderColor;
+    const int oldBorderWidth = m_borderWidth;
+    const bool oldTabBarCompact = m_tabBarCompact;
+    const int oldTabBarLeft = m_tabBarLeft;
+    const int oldTabBarRight = m_tabBarRight;
+    const int oldTitleBarHeight = m_elementSizes[TitleBarBackground].height();
+    const int oldTabBarHeight = m_elementSizes[TabBarBackground].height();
+
+    // Compact tab bar positions are derived from the raw config values.
+    readConfig(m_titlePath, m_tabPath);
+
+    std::array<QString, ElementCount> changedPaths;
+    std::array<bool, ElementCount> changedElements;
+    changedElements.fill(false);
+
+    for (int i = 0; i < ElementCount; ++i) {
+        const QString &path = m_elementPaths[i];
+
+        if (path == oldPaths[i] && (path.isEmpty() || lastModified(path) == m_fileModified.value(path)))
+            continue;
+
+        changedElements[i] = true;
+        changedPaths[i] = path;
+        sections |= elementSection(static_cast<Element>(i));
+    }
+
+    const std::array<QImage, ElementCount> images = decodeImages(changedPaths, m_devicePixelRatio);
+
+    QList<int> patches;
+    bool rebuildAtlas = false;
+
+    for (int i = 0; i < ElementCount; ++i) {
+        if (!changedElements[i])
+            continue;
+
+        m_elementSizes[i] = (QSizeF(images[i].size()) / images[i].devicePixelRatio()).toSize();
+
+        if (isTiledElement(static_cast<Element>(i)))
+            m_elements[i] = QPixmap::fromImage(images[i]);
+        else if (m_atlasRects[i].isValid() && images[i].size() == m_atlasRects[i].size())
+            patches.append(i);
+        else
+            rebuildAtlas = true;
+    }
+
+    if (rebuildAtlas) {
+        for (int i = 0; i < ElementCount; ++i) {
+            if (changedElements[i] && !isTiledElement(static_cast<Element>(i))) {
+                m_elements[i] = QPixmap::fromImage(images[i]);
+            } else if (m_atlasRects[i].isValid()) {
+                m_elements[i] = m_atlas.copy(m_atlasRects[i]);
+                m_elements[i].setDevicePixelRatio(m_devicePixelRatio);
+            }
+        }
+
+        buildAtlas();
+    } else if (!patches.isEmpty()) {
+        QImage atlas = m_atlas.toImage();
+        atlas.setDevicePixelRatio(1.0);
+
+        QPainter painter(&atlas);
+        painter.setCompositionMode(QPainter::CompositionMode_Source);
+
+        for (int i : std::as_const(patches))
+            painter.drawImage(m_atlasRects[i], images[i], images[i].rect());
+
+        painter.end();
+
+        atlas.setDevicePixelRatio(m_devicePixelRatio);
+        m_atlas = QPixmap::fromImage(std::move(atlas));
+    }
+
+    if (sections & TabBarSection) {
+        if (m_atlasRects[TabBarPreventClosing].isValid() || !m_elements[TabBarPreventClosing].isNull())
+            m_tabBarPreventClosingImageCached = QPixmap();
+        else
+            updateTabBarPreventClosingImageCache();
+    }
+
+    applyCompactLayout(m_elementSizes[TabBarCloseTabButtonUp].width());
+
+    if (m_borderColor != oldBorderColor || m_borderWidth != oldBorderWidth)
+        sections |= BorderSection;
+
+    if (m_borderWidth != oldBorderWidth || m_tabBarCompact != oldTabBarCompact || m_tabBarLeft != oldTabBarLeft || m_tabBarRight != oldTabBarRight
+        || m_elementSizes[TitleBarBackground].height() != oldTitleBarHeight || m_elementSizes[TabBarBackground].height() != oldTabBarHeight)
+        sections |= GeometrySection;
+
+    updateWatcher();
+
+    qCDebug(YAKUAKE_LOG) << "Reloaded" << std::count(changedElements.begin(), changedElements.end(), true) << "changed skin elements," << patches.size()
+                         << "patched in place";
+
+    if (sections != NoSection)
+        Q_EMIT changed(sections);
+}
+
+void Skin::loadFiles(const QString &cachePath, const QString &titlePath, const QString &tabPath, qreal dpr)
+{
+    readConfig(titlePath, tabPath);
+
+    const std::array<QImage, ElementCount> images = decodeImages(m_elementPaths, dpr);
+
+    for (int i = 0; i < ElementCount; ++i)
+        m_elements[i] = QPixmap::fromImage(images[i]);
+
+    applyCompactLayout(qRound(m_elements[TabBarCloseTabButtonUp].deviceIndependentSize().width()));
+
+    if (!cachePath.isEmpty())
+        writeCache(cachePath, titlePath, tabPath, dpr, m_elementPaths, images);
+}
+
+void Skin::readConfig(const QString &titlePath, const QString &tabPath)
+{
     const QString titleDir(QFileInfo(titlePath).absolutePath());
     const QString tabDir(QFileInfo(tabPath).absolutePath());
 
-    KConfig titleConfig(titlePath, KConfig::SimpleConfig);
-    KConfig tabConfig(tabPath, KConfig::SimpleConfig);
+    const SkinConfig titleConfig(titlePath);
+    const SkinConfig tabConfig(tabPath);
 
-    KConfigGroup border = titleConfig.group(QStringLiteral("Border"));
+    SkinConfigGroup border = titleConfig.group(QStringLiteral("Border"));
 
     m_borderColor = QColor(border.readEntry("red", 0), border.readEntry("green", 0), border.readEntry("blue", 0));
 
     m_borderWidth = border.readEntry("width", 1);
 
-    KConfigGroup titleBarBackground = titleConfig.group(QStringLiteral("Background"));
+    SkinConfigGroup titleBarBackground = titleConfig.group(QStringLiteral("Background"));
 
-    m_titleBarBackgroundImage.load(titleDir + titleBarBackground.readEntry("back_image", ""));
-    m_titleBarLeftCornerImage.load(titleDir + titleBarBackground.readEntry("left_corner", ""));
-    m_titleBarRightCornerImage.load(titleDir + titleBarBackground.readEntry("right_corner", ""));
+    m_elementPaths[TitleBarBackground] = imagePath(titleDir, titleBarBackground, "back_image");
+    m_elementPaths[TitleBarLeftCorner] = imagePath(titleDir, titleBarBackground, "left_corner");
+    m_elementPaths[TitleBarRightCorner] = imagePath(titleDir, titleBarBackground, "right_corner");
 
-    KConfigGroup titleBarFocusButton = titleConfig.group(QStringLiteral("FocusButton"));
+    SkinConfigGroup titleBarFocusButton = titleConfig.group(QStringLiteral("FocusButton"));
 
     m_titleBarFocusButtonPosition.setX(titleBarFocusButton.readEntry("x", 0));
     m_titleBarFocusButtonPosition.setY(titleBarFocusButton.readEntry("y", 0));
 
-    m_titleBarFocusButtonStyleSheet = buttonStyleSheet(titleDir + titleBarFocusButton.readEntry("up_image", ""),
-                                                       titleDir + titleBarFocusButton.readEntry("over_image", ""),
-                                                       titleDir + titleBarFocusButton.readEntry("down_image", ""));
+    m_elementPaths[TitleBarFocusButtonUp] = imagePath(titleDir, titleBarFocusButton, "up_image");
+    m_elementPaths[TitleBarFocusButtonOver] = imagePath(titleDir, titleBarFocusButton, "over_image");
+    m_elementPaths[TitleBarFocusButtonDown] = imagePath(titleDir, titleBarFocusButton, "down_image");
 
     m_titleBarFocusButtonAnchor = titleBarFocusButton.readEntry("anchor", "") == QLatin1String("left") ? Qt::AnchorLeft : Qt::AnchorRight;
 
-    KConfigGroup titleBarMenuButton = titleConfig.group(QStringLiteral("ConfigButton"));
+    SkinConfigGroup titleBarMenuButton = titleConfig.group(QStringLiteral("ConfigButton"));
 
     m_titleBarMenuButtonPosition.setX(titleBarMenuButton.readEntry("x", 0));
     m_titleBarMenuButtonPosition.setY(titleBarMenuButton.readEntry("y", 0));
 
-    m_titleBarMenuButtonStyleSheet = buttonStyleSheet(titleDir + titleBarMenuButton.readEntry("up_image", ""),
-                                                      titleDir + titleBarMenuButton.readEntry("over_image", ""),
-                                                      titleDir + titleBarMenuButton.readEntry("down_image", ""));
+    m_elementPaths[TitleBarMenuButtonUp] = imagePath(titleDir, titleBarMenuButton, "up_image");
+    m_elementPaths[TitleBarMenuButtonOver] = imagePath(titleDir, titleBarMenuButton, "over_image");
+    m_elementPaths[TitleBarMenuButtonDown] = imagePath(titleDir, titleBarMenuButton, "down_image");
 
     m_titleBarMenuButtonAnchor = titleBarMenuButton.readEntry("anchor", "") == QLatin1String("left") ? Qt::AnchorLeft : Qt::AnchorRight;
 
-    KConfigGroup titleBarQuitButton = titleConfig.group(QStringLiteral("QuitButton"));
+    SkinConfigGroup titleBarQuitButton = titleConfig.group(QStringLiteral("QuitButton"));
 
     m_titleBarQuitButtonPosition.setX(titleBarQuitButton.readEntry("x", 0));
     m_titleBarQuitButtonPosition.setY(titleBarQuitButton.readEntry("y", 0));
 
-    m_titleBarQuitButtonStyleSheet = buttonStyleSheet(titleDir + titleBarQuitButton.readEntry("up_image", ""),
-                                                      titleDir + titleBarQuitButton.readEntry("over_image", ""),
-                                                      titleDir + titleBarQuitButton.readEntry("down_image", ""));
+    m_elementPaths[TitleBarQuitButtonUp] = imagePath(titleDir, titleBarQuitButton, "up_image");
+    m_elementPaths[TitleBarQuitButtonOver] = imagePath(titleDir, titleBarQuitButton, "over_image");
+    m_elementPaths[TitleBarQuitButtonDown] = imagePath(titleDir, titleBarQuitButton, "down_image");
 
     m_titleBarQuitButtonAnchor = titleBarQuitButton.readEntry("anchor", "") == QLatin1String("left") ? Qt::AnchorLeft : Qt::AnchorRight;
 
-    KConfigGroup titleBarText = titleConfig.group(QStringLiteral("Text"));
+    SkinConfigGroup titleBarText = titleConfig.group(QStringLiteral("Text"));
 
     m_titleBarText = titleBarText.readEntry("text", "");
 
@@ -95,54 +673,59 @@ bool Skin::load(const QString &name, bool kns)
     m_titleBarTextBold = titleBarText.readEntry("bold", true);
     m_titleBarTextCentered = titleBarText.readEntry("centered", false);
 
-    KConfigGroup tabBar = tabConfig.group(QStringLiteral("Tabs"));
+    SkinConfigGroup tabBar = tabConfig.group(QStringLiteral("Tabs"));
 
     m_tabBarPosition.setX(tabBar.readEntry("x", 0));
     m_tabBarPosition.setY(tabBar.readEntry("y", 0));
 
     m_tabBarTextColor = QColor(tabBar.readEntry("red", 0), tabBar.readEntry("green", 0), tabBar.readEntry("blue", 0));
 
-    m_tabBarSeparatorImage.load(tabDir + tabBar.readEntry("separator_image", ""));
-    m_tabBarUnselectedBackgroundImage.load(tabDir + tabBar.readEntry("unselected_background", ""));
-    m_tabBarSelectedBackgroundImage.load(tabDir + tabBar.readEntry("selected_background", ""));
-    m_tabBarUnselectedLeftCornerImage.load(tabDir + tabBar.readEntry("unselected_left_corner", ""));
-    m_tabBarUnselectedRightCornerImage.load(tabDir + tabBar.readEntry("unselected_right_corner", ""));
-    m_tabBarSelectedLeftCornerImage.load(tabDir + tabBar.readEntry("selected_left_corner", ""));
-    m_tabBarSelectedRightCornerImage.load(tabDir + tabBar.readEntry("selected_right_corner", ""));
+    m_elementPaths[TabBarSeparator] = imagePath(tabDir, tabBar, "separator_image");
+    m_elementPaths[TabBarUnselectedBackground] = imagePath(tabDir, tabBar, "unselected_background");
+    m_elementPaths[TabBarSelectedBackground] = imagePath(tabDir, tabBar, "selected_background");
+    m_elementPaths[TabBarUnselectedLeftCorner] = imagePath(tabDir, tabBar, "unselected_left_corner");
+    m_elementPaths[TabBarUnselectedRightCorner] = imagePath(tabDir, tabBar, "unselected_right_corner");
+    m_elementPaths[TabBarSelectedLeftCorner] = imagePath(tabDir, tabBar, "selected_left_corner");
+    m_elementPaths[TabBarSelectedRightCorner] = imagePath(tabDir, tabBar, "selected_right_corner");
     m_tabBarSelectedTextBold = tabBar.readEntry("selected_text_bold", true);
 
-    m_tabBarPreventClosingImage.load(tabDir + tabBar.readEntry("prevent_closing_image", ""));
+    m_elementPaths[TabBarPreventClosing] = imagePath(tabDir, tabBar, "prevent_closing_image");
     m_tabBarPreventClosingImagePosition.setX(tabBar.readEntry("prevent_closing_image_x", 0));
     m_tabBarPreventClosingImagePosition.setY(tabBar.readEntry("prevent_closing_image_y", 0));
 
     m_tabBarCompact = tabBar.readEntry("compact", false);
 
-    KConfigGroup tabBarBackground = tabConfig.group(QStringLiteral("Background"));
+    SkinConfigGroup tabBarBackground = tabConfig.group(QStringLiteral("Background"));
 
-    m_tabBarBackgroundImage.load(tabDir + tabBarBackground.readEntry("back_image", ""));
-    m_tabBarLeftCornerImage.load(tabDir + tabBarBackground.readEntry("left_corner", ""));
-    m_tabBarRightCornerImage.load(tabDir + tabBarBackground.readEntry("right_corner", ""));
+    m_elementPaths[TabBarBackground] = imagePath(tabDir, tabBarBackground, "back_image");
+    m_elementPaths[TabBarLeftCorner] = imagePath(tabDir, tabBarBackground, "left_corner");
+    m_elementPaths[TabBarRightCorner] = imagePath(tabDir, tabBarBackground, "right_corner");
 
-    KConfigGroup tabBarNewTabButton = tabConfig.group(QStringLiteral("PlusButton"));
+    SkinConfigGroup tabBarNewTabButton = tabConfig.group(QStringLiteral("PlusButton"));
 
     m_tabBarNewTabButtonPosition.setX(tabBarNewTabButton.readEntry("x", 0));
     m_tabBarNewTabButtonPosition.setY(tabBarNewTabButton.readEntry("y", 0));
 
-    m_tabBarNewTabButtonStyleSheet = buttonStyleSheet(tabDir + tabBarNewTabButton.readEntry("up_image", ""),
-                                                      tabDir + tabBarNewTabButton.readEntry("over_image", ""),
-                                                      tabDir + tabBarNewTabButton.readEntry("down_image", ""));
+    m_elementPaths[TabBarNewTabButtonUp] = imagePath(tabDir, tabBarNewTabButton, "up_image");
+    m_elementPaths[TabBarNewTabButtonOver] = imagePath(tabDir, tabBarNewTabButton, "over_image");
+    m_elementPaths[TabBarNewTabButtonDown] = imagePath(tabDir, tabBarNewTabButton, "down_image");
 
     m_tabBarNewTabButtonIsAtEndOfTabs = tabBarNewTabButton.readEntry("at_end_of_tabs", false);
 
-    KConfigGroup tabBarCloseTabButton = tabConfig.group(QStringLiteral("MinusButton"));
+    SkinConfigGroup tabBarCloseTabButton = tabConfig.group(QStringLiteral("MinusButton"));
 
     m_tabBarCloseTabButtonPosition.setX(tabBarCloseTabButton.readEntry("x", 0));
     m_tabBarCloseTabButtonPosition.setY(tabBarCloseTabButton.readEntry("y", 0));
 
-    m_tabBarCloseTabButtonStyleSheet = buttonStyleSheet(tabDir + tabBarCloseTabButton.readEntry("up_image", ""),
-                                                        tabDir + tabBarCloseTabButton.readEntry("over_image", ""),
-                                                        tabDir + tabBarCloseTabButton.readEntry("down_image", ""));
+    m_elementPaths[TabBarCloseTabButtonUp] = imagePath(tabDir, tabBarCloseTabButton, "up_image");
+    m_elementPaths[TabBarCloseTabButtonOver] = imagePath(tabDir, tabBarCloseTabButton, "over_image");
+    m_elementPaths[TabBarCloseTabButtonDown] = imagePath(tabDir, tabBarCloseTabButton, "down_image");
+}
 
+// Compact tab bars are laid out relative to the tab area rather than the
+// whole window, which depends on the width of the close button.
+void Skin::applyCompactLayout(int closeButtonWidth)
+{
     if (m_tabBarCompact) {
         if (m_tabBarNewTabButtonIsAtEndOfTabs) {
             m_tabBarLeft = m_tabBarPosition.x();
@@ -157,87 +740,678 @@ bool Skin::load(const QString &name, bool kns)
             m_tabBarNewTabButtonPosition.setX(m_tabBarNewTabButtonPosition.x() - m_tabBarLeft);
         }
 
-        int closeButtonWidth = QPixmap(tabDir + tabBarCloseTabButton.readEntry("up_image", "")).width();
         m_tabBarRight = m_tabBarCloseTabButtonPosition.x() - closeButtonWidth;
         m_tabBarCloseTabButtonPosition.setX(closeButtonWidth);
     }
+}
 
-    if (m_tabBarPreventClosingImage.isNull())
-        updateTabBarPreventClosingImageCache();
+QString Skin::cacheFilePath(const QString &titlePath, const QString &tabPath, qreal dpr)
+{
+    const QByteArray key = (titlePath + QLatin1Char('\n') + tabPath + QLatin1Char('\n') + QString::number(dpr)).toUtf8();
+
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/skins/")
+        + QString::fromLatin1(QCryptographicHash::hash(key, QCryptographicHash::Sha1).toHex()) + QStringLiteral(".cache");
+}
+
+// The cache file starts with the size of a QDataStream header holding the
+// validation data, the element image records and the parsed metrics. It is
+// validated against the modification times of the descriptors and of each
+// image file, so that images replaced while Yakuake was not running, or not
+// watching, are not served from it. The raw image data follows, each image
+// starting on a CacheAlignment boundary, so that the images can be used
+// straight from the mapped file.
+bool Skin::loadCache(const QString &cachePath, const QString &titlePath, const QString &tabPath, qreal dpr)
+{
+    QSharedPointer<QFile> file(new QFile(cachePath));
+
+    if (!file->open(QIODevice::ReadOnly) || file->size() < qint64(sizeof(quint64)))
+        return false;
+
+    const qint64 fileSize = file->size();
+    const uchar *data = file->map(0, fileSize);
+
+    if (!data)
+        return false;
+
+    const quint64 headerSize = qFromBigEndian<quint64>(data);
+
+    if (headerSize > quint64(fileSize) - sizeof(quint64))
+        return false;
+
+    const QByteArray header = QByteArray::fromRawData(reinterpret_cast<const char *>(data + sizeof(quint64)), qsizetype(headerSize));
+    const qint64 dataStart = alignedCacheOffset(qint64(sizeof(quint64) + headerSize));
+
+    QDataStream stream(header);
+    stream.setVersion(QDataStream::Qt_6_0);
+
+    quint32 magic;
+    quint32 version;
+    QString cachedTitlePath;
+    qint64 titleModified;
+    QString cachedTabPath;
+    qint64 tabModified;
+    qreal cachedDpr;
+
+    stream >> magic >> version;
+
+    if (magic != CacheMagic || version != CacheVersion)
+        return false;
+
+    stream >> cachedTitlePath >> titleModified >> cachedTabPath >> tabModified >> cachedDpr;
+
+    if (cachedTitlePath != titlePath || cachedTabPath != tabPath || titleModified != lastModified(titlePath) || tabModified != lastModified(tabPath)
+        || !qFuzzyCompare(cachedDpr, dpr))
+        return false;
+
+    std::array<QString, ElementCount> paths;
+    std::array<QImage, ElementCount> images;
+    QHash<QString, qint64> modifiedTimes;
+
+    for (int i = 0; i < ElementCount; ++i) {
+        QString path;
+        qint64 modified;
+        qint32 width;
+        qint32 height;
+        qint32 format;
+        qreal imageDpr;
+        qint64 bytesPerLine;
+        qint64 offset;
+
+        stream >> path >> modified >> width >> height >> format >> imageDpr >> bytesPerLine >> offset;
+
+        if (stream.status() != QDataStream::Ok)
+            return false;
+
+        // Files used by several elements are only looked at once.
+        if (!modifiedTimes.contains(path))
+            modifiedTimes.insert(path, lastModified(path));
+
+        if (modified != modifiedTimes.value(path))
+            return false;
+
+        paths[i] = path;
+
+        if (width <= 0 || height <= 0)
+            continue;
+
+        if (format != QImage::Format_ARGB32_Premultiplied && format != QImage::Format_RGB32)
+            return false;
+
+        if (bytesPerLine < width * 4 || offset < 0 || dataStart + offset + bytesPerLine * height > fileSize)
+            return false;
+
+        // Each image holds a reference to the mapping; the file is unmapped
+        // once the last pixmap using it is gone.
+        images[i] = QImage(
+            data + dataStart + offset,
+            width,
+            height,
+            bytesPerLine,
+            static_cast<QImage::Format>(format),
+            [](void *info) {
+                delete static_cast<QSharedPointer<QFile> *>(info);
+            },
+            new QSharedPointer<QFile>(file));
+        images[i].setDevicePixelRatio(imageDpr);
+    }
+
+    readMetrics(stream);
+
+    if (stream.status() != QDataStream::Ok)
+        return false;
+
+    m_elementPaths = paths;
+
+    for (int i = 0; i < ElementCount; ++i)
+        m_elements[i] = QPixmap::fromImage(images[i]);
+
+    m_cacheMapping = file.toWeakRef();
+    m_cacheMappingSize = fileSize;
+
+    return true;
+}
+
+void Skin::writeCache(const QString &cachePath,
+                      const QString &titlePath,
+                      const QString &tabPath,
+                      qreal dpr,
+                      const std::array<QString, ElementCount> &paths,
+                      const std::array<QImage, ElementCount> &images)
+{
+    QByteArray header;
+    QDataStream stream(&header, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_6_0);
+
+    stream << CacheMagic << CacheVersion;
+    stream << titlePath << lastModified(titlePath) << tabPath << lastModified(tabPath) << dpr;
+
+    std::array<qint64, ElementCount> offsets;
+    qint64 offset = 0;
+
+    for (int i = 0; i < ElementCount; ++i) {
+        const QImage &image = images[i];
+
+        offsets[i] = offset;
+        offset = alignedCacheOffset(offset + image.sizeInBytes());
+
+        stream << paths[i] << lastModified(paths[i]) << qint32(image.width()) << qint32(image.height()) << qint32(image.format())
+               << image.devicePixelRatio() << qint64(image.bytesPerLine()) << offsets[i];
+    }
+
+    writeMetrics(stream);
+
+    QThreadPool::globalInstance()->start([cachePath, header, images, offsets]() {
+        QDir().mkpath(QFileInfo(cachePath).absolutePath());
+
+        QSaveFile file(cachePath);
+
+        if (!file.open(QIODevice::WriteOnly))
+            return;
+
+        const quint64 headerSize = qToBigEndian<quint64>(header.size());
+        file.write(reinterpret_cast<const char *>(&headerSize), sizeof(headerSize));
+        file.write(header);
+
+        const qint64 dataStart = alignedCacheOffset(qint64(sizeof(quint64)) + header.size());
+
+        for (int i = 0; i < ElementCount; ++i) {
+            if (images[i].isNull())
+                continue;
+
+            file.write(QByteArray(dataStart + offsets[i] - file.pos(), '\0'));
+            file.write(reinterpret_cast<const char *>(images[i].constBits()), images[i].sizeInBytes());
+        }
+
+        if (!file.commit())
+            qCWarning(YAKUAKE_LOG) << "Could not write skin cache" << cachePath << file.errorString();
+    });
+}
+
+void Skin::readMetrics(QDataStream &stream)
+{
+    qint32 focusButtonAnchor;
+    qint32 menuButtonAnchor;
+    qint32 quitButtonAnchor;
+
+    stream >> m_borderColor >> m_borderWidth;
+    stream >> m_titleBarFocusButtonPosition >> focusButtonAnchor;
+    stream >> m_titleBarMenuButtonPosition >> menuButtonAnchor;
+    stream >> m_titleBarQuitButtonPosition >> quitButtonAnchor;
+    stream >> m_titleBarText >> m_titleBarTextPosition >> m_titleBarTextColor >> m_titleBarTextBold >> m_titleBarTextCentered;
+    stream >> m_tabBarPosition >> m_tabBarTextColor >> m_tabBarSelectedTextBold >> m_tabBarPreventClosingImagePosition;
+    stream >> m_tabBarNewTabButtonPosition >> m_tabBarNewTabButtonIsAtEndOfTabs;
+    stream >> m_tabBarCompact >> m_tabBarLeft >> m_tabBarRight;
+    stream >> m_tabBarCloseTabButtonPosition;
+
+    m_titleBarFocusButtonAnchor = static_cast<Qt::AnchorPoint>(focusButtonAnchor);
+    m_titleBarMenuButtonAnchor = static_cast<Qt::AnchorPoint>(menuButtonAnchor);
+    m_titleBarQuitButtonAnchor = static_cast<Qt::AnchorPoint>(quitButtonAnchor);
+}
+
+void Skin::writeMetrics(QDataStream &stream) const
+{
+    stream << m_borderColor << m_borderWidth;
+    stream << m_titleBarFocusButtonPosition << qint32(m_titleBarFocusButtonAnchor);
+    stream << m_titleBarMenuButtonPosition << qint32(m_titleBarMenuButtonAnchor);
+    stream << m_titleBarQuitButtonPosition << qint32(m_titleBarQuitButtonAnchor);
+    stream << m_titleBarText << m_titleBarTextPosition << m_titleBarTextColor << m_titleBarTextBold << m_titleBarTextCentered;
+    stream << m_tabBarPosition << m_tabBarTextColor << m_tabBarSelectedTextBold << m_tabBarPreventClosingImagePosition;
+    stream << m_tabBarNewTabButtonPosition << m_tabBarNewTabButtonIsAtEndOfTabs;
+    stream << m_tabBarCompact << m_tabBarLeft << m_tabBarRight;
+    stream << m_tabBarCloseTabButtonPosition;
+}
+
+bool Skin::isTiledElement(Element element)
+{
+    return element == TitleBarBackground || element == TabBarBackground || element == TabBarSelectedBackground || element == TabBarUnselectedBackground;
+}
+
+// Packs the non-tiled elements into a single pixmap, tallest first, on
+// shelves of roughly square total extent. Elements are kept a pixel apart so
+// scaled draws don't sample their neighbours.
+void Skin::buildAtlas()
+{
+    const int spacing = 1;
+
+    QList<int> packed;
+    qint64 area = 0;
+    int widest = 0;
+    qint64 separateBytes = 0;
+
+    m_atlas = QPixmap();
+    m_atlasRects.fill(QRect());
+
+    for (int i = 0; i < ElementCount; ++i) {
+        if (m_elements[i].isNull() || isTiledElement(static_cast<Element>(i)))
+            continue;
+
+        packed.append(i);
+        area += qint64(m_elements[i].width() + spacing) * (m_elements[i].height() + spacing);
+        widest = qMax(widest, m_elements[i].width());
+        separateBytes += qint64(m_elements[i].width()) * m_elements[i].height() * m_elements[i].depth() / 8;
+    }
+
+    if (packed.isEmpty())
+        return;
+
+    std::stable_sort(packed.begin(), packed.end(), [this](int a, int b) {
+        return m_elements[a].height() > m_elements[b].height();
+    });
+
+    const int atlasWidth = qMax(widest, qCeil(std::sqrt(double(area))));
+    int x = 0;
+    int y = 0;
+    int shelfHeight = 0;
+
+    for (int i : std::as_const(packed)) {
+        const QSize size = m_elements[i].size();
+
+        if (x + size.width() > atlasWidth) {
+            x = 0;
+            y += shelfHeight + spacing;
+            shelfHeight = 0;
+        }
+
+        m_atlasRects[i] = QRect(QPoint(x, y), size);
+
+        x += size.width() + spacing;
+        shelfHeight = qMax(shelfHeight, size.height());
+    }
+
+    QImage atlas(atlasWidth, y + shelfHeight, QImage::Format_ARGB32_Premultiplied);
+    atlas.fill(Qt::transparent);
+
+    QPainter painter(&atlas);
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+
+    for (int i : std::as_const(packed)) {
+        painter.drawImage(m_atlasRects[i], m_elements[i].toImage(), QRect(QPoint(0, 0), m_elements[i].size()));
+        m_elements[i] = QPixmap();
+    }
+
+    painter.end();
+
+    atlas.setDevicePixelRatio(m_devicePixelRatio);
+    m_atlas = QPixmap::fromImage(std::move(atlas));
+
+    qCDebug(YAKUAKE_LOG) << "Packed" << packed.size() << "skin elements into a" << m_atlas.size() << "atlas of"
+                         << qint64(m_atlas.width()) * m_atlas.height() * m_atlas.depth() / 8 << "bytes, previously" << separateBytes << "bytes in"
+                         << packed.size() << "pixmaps";
+}
+
+static qint64 pixmapBytes(const QPixmap &pixmap)
+{
+    return qint64(pixmap.width()) * pixmap.height() * pixmap.depth() / 8;
+}
+
+qint64 Skin::residentBytes() const
+{
+    qint64 bytes = pixmapBytes(m_atlas) + pixmapBytes(m_tabBarPreventClosingImageCached);
+
+    for (const QPixmap &element : std::as_const(m_elements))
+        bytes += pixmapBytes(element);
+
+    // Pixmaps may still be backed by the mapped cache file.
+    if (!m_cacheMapping.isNull())
+        bytes += m_cacheMappingSize;
+
+    return bytes;
+}
+
+qint64 Skin::releaseCaches()
+{
+    // Without a cache file to map, bringing the images back would mean a
+    // decode on the open path, so such skins keep them.
+    if (!m_colorScheme && !isCompiledIn() && !QFile::exists(cacheFilePath(m_titlePath, m_tabPath, m_devicePixelRatio)))
+        return 0;
+
+    const qint64 bytes = residentBytes();
+
+    m_atlas = QPixmap();
+    m_atlasRects.fill(QRect());
+    m_elements.fill(QPixmap());
+    m_tabBarPreventClosingImageCached = QPixmap();
+
+    m_cachesReleased = true;
+    ++m_decodeGeneration;
+
+    return bytes;
+}
+
+// Runs on the open path, so its cost is bounded: the compiled-in skins are
+// rendered again from the vector images in the binary, their metrics being
+// untouched, and other skins are mapped from the cache file they were
+// released with. Only if that file went away since are the images decoded
+// again, which is waited on for at most RestoreDecodeTimeout before the
+// window opens without them.
+bool Skin::restoreCaches(qreal devicePixelRatio)
+{
+    if (!m_cachesReleased)
+        return true;
+
+    m_devicePixelRatio = devicePixelRatio;
+
+    if (m_colorScheme) {
+        renderColorScheme();
+    } else if (isCompiledIn()) {
+        const std::array<QImage, ElementCount> images = decodeImages(m_elementPaths, m_devicePixelRatio);
+
+        for (int i = 0; i < ElementCount; ++i)
+            m_elements[i] = QPixmap::fromImage(images[i]);
+    } else {
+        const QString cachePath = cacheFilePath(m_titlePath, m_tabPath, m_devicePixelRatio);
+
+        if (!loadCache(cachePath, m_titlePath, m_tabPath, m_devicePixelRatio)) {
+            const std::array<QString, ElementCount> paths = m_elementPaths;
+            const qreal dpr = m_devicePixelRatio;
+            const int generation = ++m_decodeGeneration;
+            const auto images = std::make_shared<std::array<QImage, ElementCount>>();
+
+            m_decodePool.start([this, paths, dpr, cachePath, generation, images]() {
+                *images = decodeImages(paths, dpr);
+
+                QMetaObject::invokeMethod(
+                    this,
+                    [this, cachePath, generation, images]() {
+                        if (restoreImages(*images, cachePath, generation))
+                            Q_EMIT changed(TitleBarSection | TabBarSection);
+                    },
+                    Qt::QueuedConnection);
+            });
+
+            if (!m_decodePool.waitForDone(RestoreDecodeTimeout))
+                return false;
+
+            return restoreImages(*images, cachePath, generation);
+        }
+    }
+
+    m_cachesReleased = false;
+    updateElements();
 
     return true;
 }
 
-const QString Skin::buttonStyleSheet(const QString &up, const QString &over, const QString &down)
+// Takes the images decoded by restoreCaches(), unless they were taken
+// already or the skin was loaded or released again in the meantime.
+bool Skin::restoreImages(const std::array<QImage, ElementCount> &images, const QString &cachePath, int generation)
 {
-    QString styleSheet;
+    if (generation != m_decodeGeneration || !m_cachesReleased)
+        return false;
 
-    QString borderBit(QStringLiteral("border: none;"));
+    for (int i = 0; i < ElementCount; ++i)
+        m_elements[i] = QPixmap::fromImage(images[i]);
 
-    QPixmap buttonImage(up);
-    QString w(QString::number(buttonImage.width()));
-    QString h(QString::number(buttonImage.height()));
+    m_cachesReleased = false;
+    updateElements();
 
-    QString sizeBit(QStringLiteral("min-width:") + w + QStringLiteral("; min-height:") + h + QStringLiteral("; max-width:") + w
-                    + QStringLiteral("; max-height:") + h + QStringLiteral(";"));
+    writeCache(cachePath, m_titlePath, m_tabPath, m_devicePixelRatio, m_elementPaths, images);
 
-    styleSheet.append(QStringLiteral("QPushButton {") + borderBit + QStringLiteral("image:url(") + up + QStringLiteral(");") + sizeBit + QStringLiteral("}"));
-    styleSheet.append(QStringLiteral("QPushButton::hover {") + borderBit + QStringLiteral("image:url(") + over + QStringLiteral(");") + sizeBit
-                      + QStringLiteral("}"));
-    styleSheet.append(QStringLiteral("QPushButton::pressed {") + borderBit + QStringLiteral("image:url(") + down + QStringLiteral(");") + sizeBit
-                      + QStringLiteral("}"));
-    styleSheet.append(QStringLiteral("QPushButton::checked {") + borderBit + QStringLiteral("image:url(") + down + QStringLiteral(");") + sizeBit
-                      + QStringLiteral("}"));
-    styleSheet.append(QStringLiteral("QPushButton::open {") + borderBit + QStringLiteral("image:url(") + down + QStringLiteral(");") + sizeBit
-                      + QStringLiteral("}"));
-    styleSheet.append(QStringLiteral("QPushButton::menu-indicator { left: ") + w + QStringLiteral(" }"));
+    return true;
+}
 
-    styleSheet.append(QStringLiteral("QToolButton {") + borderBit + QStringLiteral("image:url(") + up + QStringLiteral(");") + sizeBit + QStringLiteral("}"));
-    styleSheet.append(QStringLiteral("QToolButton::hover {") + borderBit + QStringLiteral("image:url(") + over + QStringLiteral(");") + sizeBit
-                      + QStringLiteral("}"));
-    styleSheet.append(QStringLiteral("QToolButton::pressed {") + borderBit + QStringLiteral("image:url(") + down + QStringLiteral(");") + sizeBit
-                      + QStringLiteral("}"));
-    styleSheet.append(QStringLiteral("QToolButton::checked {") + borderBit + QStringLiteral("image:url(") + down + QStringLiteral(");") + sizeBit
-                      + QStringLiteral("}"));
-    styleSheet.append(QStringLiteral("QToolButton::open {") + borderBit + QStringLiteral("image:url(") + down + QStringLiteral(");") + sizeBit
-                      + QStringLiteral("}"));
-    styleSheet.append(QStringLiteral("QToolButton::menu-indicator { left: ") + w + QStringLiteral(" }"));
+// Derives the element sizes, the atlas and the themed lock icon from freshly
+// loaded element pixmaps.
+void Skin::updateElements()
+{
+    for (int i = 0; i < ElementCount; ++i)
+        m_elementSizes[i] = m_elements[i].deviceIndependentSize().toSize();
 
-    return styleSheet;
+    const bool usePreventClosingIcon = m_elements[TabBarPreventClosing].isNull();
+
+    buildAtlas();
+
+    if (usePreventClosingIcon)
+        updateTabBarPreventClosingImageCache();
+    else
+        m_tabBarPreventClosingImageCached = QPixmap();
 }
 
-const QPixmap Skin::tabBarPreventClosingImage()
+bool Skin::hasElement(Element element) const
 {
-    if (m_tabBarPreventClosingImage.isNull())
-        return m_tabBarPreventClosingImageCached;
+    if (element == TabBarPreventClosing && !m_tabBarPreventClosingImageCached.isNull())
+        return true;
+
+    return m_atlasRects[element].isValid() || !m_elements[element].isNull();
+}
 
-    return m_tabBarPreventClosingImage;
+void Skin::drawElement(QPainter &painter, const QPoint &position, Element element) const
+{
+    const QRect &source = m_atlasRects[element];
+
+    if (source.isValid())
+        painter.drawPixmap(QRectF(position, QSizeF(source.size()) / m_atlas.devicePixelRatio()), m_atlas, source);
+    else if (!m_elements[element].isNull())
+        painter.drawPixmap(position, m_elements[element]);
+    else if (element == TabBarPreventClosing)
+        painter.drawPixmap(position, m_tabBarPreventClosingImageCached);
 }
 
 void Skin::updateTabBarPreventClosingImageCache()
 {
     // Get the target image size from the tabBar height, acquired from
     // background image, minus (2 * y position) of the lock icon.
-    int m_IconSize = m_tabBarBackgroundImage.height() - (2 * m_tabBarPreventClosingImagePosition.y());
+    int m_IconSize = m_elementSizes[TabBarBackground].height() - (2 * m_tabBarPreventClosingImagePosition.y());
 
     // Get the system lock icon in a generous size.
-    m_tabBarPreventClosingImageCached = QIcon::fromTheme(QStringLiteral("object-locked.png")).pixmap(48, 48);
+    m_tabBarPreventClosingImageCached = QIcon::fromTheme(QStringLiteral("object-locked.png")).pixmap(QSize(48, 48), m_devicePixelRatio);
 
     // Resize the image if it's too tall.
-    if (m_IconSize < m_tabBarPreventClosingImageCached.height()) {
-        m_tabBarPreventClosingImageCached = m_tabBarPreventClosingImageCached.scaled(m_IconSize, m_IconSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    if (m_IconSize < m_tabBarPreventClosingImageCached.deviceIndependentSize().height()) {
+        m_tabBarPreventClosingImageCached = m_tabBarPreventClosingImageCached.scaled(QSize(m_IconSize, m_IconSize) * m_devicePixelRatio,
+                                                                                     Qt::KeepAspectRatio,
+                                                                                     Qt::SmoothTransformation);
+        m_tabBarPreventClosingImageCached.setDevicePixelRatio(m_devicePixelRatio);
     }
+
+    m_elementSizes[TabBarPreventClosing] = m_tabBarPreventClosingImageCached.deviceIndependentSize().toSize();
+}
+
+QRegion Skin::elementMask(Element element) const
+{
+    const QPixmap pixmap = m_atlasRects[element].isValid() ? m_atlas.copy(m_atlasRects[element]) : m_elements[element];
+
+    if (!pixmap.hasAlpha())
+        return QRegion(QRect(QPoint(0, 0), m_elementSizes[element]));
+
+    const QRegion mask(pixmap.mask());
+
+    if (qFuzzyCompare(m_devicePixelRatio, qreal(1.0)))
+        return mask;
+
+    return QTransform::fromScale(1.0 / m_devicePixelRatio, 1.0 / m_devicePixelRatio).map(mask);
 }
 
 void Skin::systemIconsChanged(int group)
 {
     Q_UNUSED(group);
 
-    if (m_tabBarPreventClosingImage.isNull()) {
+    // The colour scheme skin draws its buttons from theme icons.
+    if (m_colorScheme) {
+        updateColorScheme();
+        return;
+    }
+
+    if (!m_tabBarPreventClosingImageCached.isNull()) {
         updateTabBarPreventClosingImageCache();
 
         Q_EMIT iconChanged();
     }
 }
 
+static QPixmap colorElement(const QSize &size, const QColor &color, qreal dpr)
+{
+    QPixmap pixmap(QSizeF(size * dpr).toSize());
+    pixmap.setDevicePixelRatio(dpr);
+    pixmap.fill(color);
+
+    return pixmap;
+}
+
+static QPixmap tabElement(const QSize &size, const QColor &color, const QColor &accentColor, qreal dpr)
+{
+    QPixmap pixmap = colorElement(size, color, dpr);
+
+    if (accentColor.isValid()) {
+        QPainter painter(&pixmap);
+        painter.fillRect(QRectF(0, size.height() - 2, size.width(), 2), accentColor);
+    }
+
+    return pixmap;
+}
+
+static QPixmap buttonElement(int size, const QString &iconName, const QColor &highlightColor, qreal dpr)
+{
+    QPixmap pixmap(QSizeF(QSize(size, size) * dpr).toSize());
+    pixmap.setDevicePixelRatio(dpr);
+    pixmap.fill(Qt::transparent);
+
+    QPainter painter(&pixmap);
+    painter.setRenderHint(QPainter::Antialiasing);
+
+    if (highlightColor.isValid()) {
+        painter.setPen(Qt::NoPen);
+        painter.setBrush(highlightColor);
+        painter.drawRoundedRect(QRectF(2, 2, size - 4, size - 4), 3, 3);
+    }
+
+    const int iconSize = size >= 30 ? KIconLoader::SizeSmallMedium : KIconLoader::SizeSmall;
+    const QPixmap icon = QIcon::fromTheme(iconName).pixmap(QSize(iconSize, iconSize), dpr);
+
+    painter.drawPixmap(QPointF((size - iconSize) / 2.0, (size - iconSize) / 2.0), icon);
+
+    return pixmap;
+}
+
+// Draws the colour scheme skin: the title bar uses the header colours, the
+// tab bar those of the window, buttons are theme icons with a hover and a
+// pressed highlight. Sizes follow the application font, and everything is
+// drawn at the device pixel ratio, so there's nothing to scale.
+void Skin::renderColorScheme()
+{
+    const KColorScheme header(QPalette::Active, KColorScheme::Header);
+    const KColorScheme window(QPalette::Active, KColorScheme::Window);
+    const KColorScheme button(QPalette::Active, KColorScheme::Button);
+    const qreal dpr = m_devicePixelRatio;
+
+    const QFontMetrics fontMetrics(QApplication::font());
+    const int titleBarHeight = qMax(30, fontMetrics.height() + 12);
+    const int tabBarHeight = qMax(22, fontMetrics.height() + 6);
+
+    const QColor titleBarColor = header.background().color();
+    const QColor tabBarColor = window.background().color();
+    const QColor accentColor = window.decoration(KColorScheme::FocusColor).color();
+
+    QColor hoverColor = button.decoration(KColorScheme::HoverColor).color();
+    hoverColor.setAlphaF(0.3);
+    QColor pressedColor = button.decoration(KColorScheme::FocusColor).color();
+    pressedColor.setAlphaF(0.5);
+
+    m_elementPaths.fill(QString());
+
+    m_borderColor = accentColor;
+    m_borderWidth = 1;
+
+    m_elements[TitleBarBackground] = colorElement(QSize(1, titleBarHeight), titleBarColor, dpr);
+    m_elements[TitleBarLeftCorner] = colorElement(QSize(1, titleBarHeight), titleBarColor, dpr);
+    m_elements[TitleBarRightCorner] = colorElement(QSize(1, titleBarHeight), titleBarColor, dpr);
+
+    const struct {
+        Element up;
+        const char *icon;
+        QPoint *position;
+        Qt::AnchorPoint *anchor;
+    } titleBarButtons[] = {
+        {TitleBarQuitButtonUp, "window-close", &m_titleBarQuitButtonPosition, &m_titleBarQuitButtonAnchor},
+        {TitleBarMenuButtonUp, "application-menu", &m_titleBarMenuButtonPosition, &m_titleBarMenuButtonAnchor},
+        {TitleBarFocusButtonUp, "window-pin", &m_titleBarFocusButtonPosition, &m_titleBarFocusButtonAnchor},
+    };
+
+    // Anchored to the right edge, which the position is measured from.
+    int buttonX = 0;
+
+    for (const auto &titleBarButton : titleBarButtons) {
+        const QString icon = QString::fromLatin1(titleBarButton.icon);
+        const int up = titleBarButton.up;
+
+        m_elements[up] = buttonElement(titleBarHeight, icon, QColor(), dpr);
+        m_elements[up + 1] = buttonElement(titleBarHeight, icon, hoverColor, dpr);
+        m_elements[up + 2] = buttonElement(titleBarHeight, icon, pressedColor, dpr);
+
+        buttonX += titleBarHeight;
+        *titleBarButton.position = QPoint(buttonX, 0);
+        *titleBarButton.anchor = Qt::AnchorRight;
+    }
+
+    m_titleBarText = i18nc("@title:window", "Drop-Down Terminal");
+    m_titleBarTextPosition = QPoint(8, (titleBarHeight + fontMetrics.ascent() - fontMetrics.descent()) / 2);
+    m_titleBarTextColor = header.foreground().color();
+    m_titleBarTextBold = false;
+    m_titleBarTextCentered = true;
+
+    m_elements[TabBarBackground] = colorElement(QSize(1, tabBarHeight), tabBarColor, dpr);
+    m_elements[TabBarLeftCorner] = colorElement(QSize(1, tabBarHeight), tabBarColor, dpr);
+    m_elements[TabBarRightCorner] = colorElement(QSize(1, tabBarHeight), tabBarColor, dpr);
+
+    const QColor selectedColor = KColorScheme(QPalette::Active, KColorScheme::View).background().color();
+
+    m_elements[TabBarSeparator] = colorElement(QSize(1, tabBarHeight), KColorScheme::shade(tabBarColor, KColorScheme::MidShade), dpr);
+    m_elements[TabBarUnselectedBackground] = tabElement(QSize(1, tabBarHeight), tabBarColor, QColor(), dpr);
+    m_elements[TabBarUnselectedLeftCorner] = tabElement(QSize(1, tabBarHeight), tabBarColor, QColor(), dpr);
+    m_elements[TabBarUnselectedRightCorner] = tabElement(QSize(1, tabBarHeight), tabBarColor, QColor(), dpr);
+    m_elements[TabBarSelectedBackground] = tabElement(QSize(1, tabBarHeight), selectedColor, accentColor, dpr);
+    m_elements[TabBarSelectedLeftCorner] = tabElement(QSize(1, tabBarHeight), selectedColor, accentColor, dpr);
+    m_elements[TabBarSelectedRightCorner] = tabElement(QSize(1, tabBarHeight), selectedColor, accentColor, dpr);
+
+    // Falls back to the themed lock icon.
+    m_elements[TabBarPreventClosing] = QPixmap();
+    m_tabBarPreventClosingImagePosition = QPoint(0, 0);
+
+    m_elements[TabBarNewTabButtonUp] = buttonElement(tabBarHeight, QStringLiteral("list-add"), QColor(), dpr);
+    m_elements[TabBarNewTabButtonOver] = buttonElement(tabBarHeight, QStringLiteral("list-add"), hoverColor, dpr);
+    m_elements[TabBarNewTabButtonDown] = buttonElement(tabBarHeight, QStringLiteral("list-add"), pressedColor, dpr);
+
+    m_elements[TabBarCloseTabButtonUp] = buttonElement(tabBarHeight, QStringLiteral("tab-close"), QColor(), dpr);
+    m_elements[TabBarCloseTabButtonOver] = buttonElement(tabBarHeight, QStringLiteral("tab-close"), hoverColor, dpr);
+    m_elements[TabBarCloseTabButtonDown] = buttonElement(tabBarHeight, QStringLiteral("tab-close"), pressedColor, dpr);
+
+    m_tabBarPosition = QPoint(tabBarHeight, 0);
+    m_tabBarTextColor = window.foreground().color();
+    m_tabBarSelectedTextBold = false;
+
+    m_tabBarNewTabButtonPosition = QPoint(0, 0);
+    m_tabBarNewTabButtonIsAtEndOfTabs = false;
+    m_tabBarCloseTabButtonPosition = QPoint(tabBarHeight, 0);
+
+    m_tabBarCompact = false;
+    m_tabBarLeft = 0;
+    m_tabBarRight = 0;
+}
+
+// Redraws the colour scheme skin, e.g. after the colour scheme or the icon
+// theme changed. There are no files to reload.
+void Skin::updateColorScheme()
+{
+    if (!m_colorScheme || m_cachesReleased)
+        return;
+
+    const int oldTitleBarHeight = m_elementSizes[TitleBarBackground].height();
+    const int oldTabBarHeight = m_elementSizes[TabBarBackground].height();
+
+    renderColorScheme();
+
+    for (int i = 0; i < ElementCount; ++i)
+        m_elementSizes[i] = m_elements[i].deviceIndependentSize().toSize();
+
+    buildAtlas();
+    updateTabBarPreventClosingImageCache();
+
+    Sections sections = BorderSection | TitleBarSection | TabBarSection;
+
+    if (m_elementSizes[TitleBarBackground].height() != oldTitleBarHeight || m_elementSizes[TabBarBackground].height() != oldTabBarHeight)
+        sections |= GeometrySection;
+
+    Q_EMIT changed(sections);
+}
+
 #include "moc_skin.cpp"
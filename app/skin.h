@@ -7,19 +7,109 @@
 #ifndef SKIN_H
 #define SKIN_H
 
+#include <QHash>
+#include <QImage>
 #include <QObject>
 #include <QPixmap>
+#include <QRegion>
 #include <QString>
+#include <QThreadPool>
+#include <QTimer>
+#include <QWeakPointer>
+
+#include <array>
+#include <memory>
+
+class SkinPackage;
+
+class QDataStream;
+class QFile;
+class QFileSystemWatcher;
+class QPainter;
 
 class Skin : public QObject
 {
     Q_OBJECT
 
 public:
+    enum Element {
+        TitleBarBackground,
+        TitleBarLeftCorner,
+        TitleBarRightCorner,
+        TitleBarFocusButtonUp,
+        TitleBarFocusButtonOver,
+        TitleBarFocusButtonDown,
+        TitleBarMenuButtonUp,
+        TitleBarMenuButtonOver,
+        TitleBarMenuButtonDown,
+        TitleBarQuitButtonUp,
+        TitleBarQuitButtonOver,
+        TitleBarQuitButtonDown,
+        TabBarSeparator,
+        TabBarUnselectedBackground,
+        TabBarSelectedBackground,
+        TabBarUnselectedLeftCorner,
+        TabBarUnselectedRightCorner,
+        TabBarSelectedLeftCorner,
+        TabBarSelectedRightCorner,
+        TabBarPreventClosing,
+        TabBarBackground,
+        TabBarLeftCorner,
+        TabBarRightCorner,
+        TabBarNewTabButtonUp,
+        TabBarNewTabButtonOver,
+        TabBarNewTabButtonDown,
+        TabBarCloseTabButtonUp,
+        TabBarCloseTabButtonOver,
+        TabBarCloseTabButtonDown,
+        ElementCount,
+    };
+
+    enum Section {
+        NoSection = 0x0,
+        BorderSection = 0x1,
+        TitleBarSection = 0x2,
+        TabBarSection = 0x4,
+        GeometrySection = 0x8,
+    };
+    Q_DECLARE_FLAGS(Sections, Section)
+
     explicit Skin();
     ~Skin() override;
 
-    bool load(const QString &name, bool kns = false);
+    bool load(const QString &name, bool kns = false, qreal devicePixelRatio = 1.0);
+
+    void setWatchFiles(bool watch);
+
+    void updateColorScheme();
+
+    // Drops the skin images until the next load() or restoreCaches(), e.g.
+    // while the window is retracted. Returns the number of bytes freed; a
+    // skin that has neither a cache file nor is compiled in keeps them.
+    qint64 releaseCaches();
+
+    // Brings the images back within a bounded time. Returns false if they
+    // are still being decoded; changed() is emitted once they are in.
+    bool restoreCaches(qreal devicePixelRatio);
+
+    // The bytes held by the skin: the atlas, the tiled backgrounds, the
+    // themed lock icon and the cache file mapping while pixmaps use it.
+    qint64 residentBytes() const;
+
+    qreal devicePixelRatio() const
+    {
+        return m_devicePixelRatio;
+    }
+
+    // Element sizes are in device independent pixels.
+    const QSize &elementSize(Element element) const
+    {
+        return m_elementSizes[element];
+    }
+    QRegion elementMask(Element element) const;
+
+    bool hasElement(Element element) const;
+    void drawElement(QPainter &painter, const QPoint &position, Element element) const;
 
     const QColor &borderColor()
     {
@@ -32,15 +122,7 @@ public:
 
     const QPixmap &titleBarBackgroundImage()
     {
-        return m_titleBarBackgroundImage;
-    }
-    const QPixmap &titleBarLeftCornerImage()
-    {
-        return m_titleBarLeftCornerImage;
-    }
-    const QPixmap &titleBarRightCornerImage()
-    {
-        return m_titleBarRightCornerImage;
+        return m_elements[TitleBarBackground];
     }
 
     const QPoint &titleBarFocusButtonPosition()
@@ -51,10 +133,6 @@ public:
     {
         return m_titleBarFocusButtonAnchor;
     }
-    const QString titleBarFocusButtonStyleSheet()
-    {
-        return m_titleBarFocusButtonStyleSheet;
-    }
 
     const QPoint &titleBarMenuButtonPosition()
     {
@@ -64,10 +142,6 @@ public:
     {
         return m_titleBarMenuButtonAnchor;
     }
-    const QString titleBarMenuButtonStyleSheet()
-    {
-        return m_titleBarMenuButtonStyleSheet;
-    }
 
     const QPoint &titleBarQuitButtonPosition()
     {
@@ -77,10 +151,6 @@ public:
     {
         return m_titleBarQuitButtonAnchor;
     }
-    const QString titleBarQuitButtonStyleSheet()
-    {
-        return m_titleBarQuitButtonStyleSheet;
-    }
 
     const QString titleBarText()
     {
@@ -112,33 +182,13 @@ public:
         return m_tabBarTextColor;
     }
 
-    const QPixmap &tabBarSeparatorImage()
-    {
-        return m_tabBarSeparatorImage;
-    }
     const QPixmap &tabBarUnselectedBackgroundImage()
     {
-        return m_tabBarUnselectedBackgroundImage;
+        return m_elements[TabBarUnselectedBackground];
     }
     const QPixmap &tabBarSelectedBackgroundImage()
     {
-        return m_tabBarSelectedBackgroundImage;
-    }
-    const QPixmap &tabBarUnselectedLeftCornerImage()
-    {
-        return m_tabBarUnselectedLeftCornerImage;
-    }
-    const QPixmap &tabBarUnselectedRightCornerImage()
-    {
-        return m_tabBarUnselectedRightCornerImage;
-    }
-    const QPixmap &tabBarSelectedLeftCornerImage()
-    {
-        return m_tabBarSelectedLeftCornerImage;
-    }
-    const QPixmap &tabBarSelectedRightCornerImage()
-    {
-        return m_tabBarSelectedRightCornerImage;
+        return m_elements[TabBarSelectedBackground];
     }
     bool tabBarSelectedTextBold()
     {
@@ -158,7 +208,6 @@ public:
         return m_tabBarRight;
     }
 
-    const QPixmap tabBarPreventClosingImage();
     const QPoint &tabBarPreventClosingImagePosition()
     {
         return m_tabBarPreventClosingImagePosition;
@@ -166,25 +215,13 @@ public:
 
     const QPixmap &tabBarBackgroundImage()
     {
-        return m_tabBarBackgroundImage;
-    }
-    const QPixmap &tabBarLeftCornerImage()
-    {
-        return m_tabBarLeftCornerImage;
-    }
-    const QPixmap &tabBarRightCornerImage()
-    {
-        return m_tabBarRightCornerImage;
+        return m_elements[TabBarBackground];
     }
 
     const QPoint &tabBarNewTabButtonPosition()
     {
         return m_tabBarNewTabButtonPosition;
     }
-    const QString tabBarNewTabButtonStyleSheet()
-    {
-        return m_tabBarNewTabButtonStyleSheet;
-    }
     bool tabBarNewTabButtonIsAtEndOfTabs()
     {
         return m_tabBarNewTabButtonIsAtEndOfTabs;
@@ -194,40 +231,81 @@ public:
     {
         return m_tabBarCloseTabButtonPosition;
     }
-    const QString tabBarCloseTabButtonStyleSheet()
-    {
-        return m_tabBarCloseTabButtonStyleSheet;
-    }
 
 Q_SIGNALS:
     void iconChanged();
+    void changed(Skin::Sections sections);
 
 private Q_SLOTS:
     void systemIconsChanged(int group);
+    void reloadChangedFiles();
 
 private:
-    const QString buttonStyleSheet(const QString &up, const QString &over, const QString &down);
+    void loadFiles(const QString &cachePath, const QString &titlePath, const QString &tabPath, qreal dpr);
+    void readConfig(const QString &titlePath, const QString &tabPath);
+    void applyCompactLayout(int closeButtonWidth);
+
+    bool isCompiledIn() const;
+    static QString cacheFilePath(const QString &titlePath, const QString &tabPath, qreal dpr);
+    bool loadCache(const QString &cachePath, const QString &titlePath, const QString &tabPath, qreal dpr);
+    void writeCache(const QString &cachePath,
+                    const QString &titlePath,
+                    const QString &tabPath,
+                    qreal dpr,
+                    const std::array<QString, ElementCount> &paths,
+                    const std::array<QImage, ElementCount> &images);
+    void readMetrics(QDataStream &stream);
+    void writeMetrics(QDataStream &stream) const;
 
     void updateTabBarPreventClosingImageCache();
 
+    void renderColorScheme();
+
+    static bool isTiledElement(Element element);
+    static Section elementSection(Element element);
+    void buildAtlas();
+    void updateElements();
+    bool restoreImages(const std::array<QImage, ElementCount> &images, const QString &cachePath, int generation);
+
+    void updateWatcher();
+
+    QString m_titlePath;
+    QString m_tabPath;
+
+    std::unique_ptr<SkinPackage> m_package;
+    qint64 m_packageModified = 0;
+
+    std::array<QString, ElementCount> m_elementPaths;
+    std::array<QPixmap, ElementCount> m_elements;
+    std::array<QSize, ElementCount> m_elementSizes;
+
+    // Everything but the tiled backgrounds is packed into the atlas; those
+    // elements no longer have a pixmap of their own in m_elements.
+    QPixmap m_atlas;
+    std::array<QRect, ElementCount> m_atlasRects;
+
+    QWeakPointer<QFile> m_cacheMapping;
+    qint64 m_cacheMappingSize = 0;
+
+    qreal m_devicePixelRatio = 1.0;
+
+    bool m_colorScheme = false;
+    bool m_cachesReleased = false;
+
+    QThreadPool m_decodePool;
+    int m_decodeGeneration = 0;
+
     QColor m_borderColor;
     int m_borderWidth;
 
-    QPixmap m_titleBarBackgroundImage;
-    QPixmap m_titleBarLeftCornerImage;
-    QPixmap m_titleBarRightCornerImage;
-
     QPoint m_titleBarFocusButtonPosition;
     Qt::AnchorPoint m_titleBarFocusButtonAnchor;
-    QString m_titleBarFocusButtonStyleSheet;
 
     QPoint m_titleBarMenuButtonPosition;
     Qt::AnchorPoint m_titleBarMenuButtonAnchor;
-    QString m_titleBarMenuButtonStyleSheet;
 
     QPoint m_titleBarQuitButtonPosition;
     Qt::AnchorPoint m_titleBarQuitButtonAnchor;
-    QString m_titleBarQuitButtonStyleSheet;
 
     QString m_titleBarText;
     QPoint m_titleBarTextPosition;
@@ -238,33 +316,25 @@ private:
     QPoint m_tabBarPosition;
     QColor m_tabBarTextColor;
 
-    QPixmap m_tabBarSeparatorImage;
-    QPixmap m_tabBarUnselectedBackgroundImage;
-    QPixmap m_tabBarSelectedBackgroundImage;
-    QPixmap m_tabBarUnselectedLeftCornerImage;
-    QPixmap m_tabBarUnselectedRightCornerImage;
-    QPixmap m_tabBarSelectedLeftCornerImage;
-    QPixmap m_tabBarSelectedRightCornerImage;
     bool m_tabBarSelectedTextBold;
 
-    QPixmap m_tabBarPreventClosingImage;
     QPixmap m_tabBarPreventClosingImageCached;
     QPoint m_tabBarPreventClosingImagePosition;
 
-    QPixmap m_tabBarBackgroundImage;
-    QPixmap m_tabBarLeftCornerImage;
-    QPixmap m_tabBarRightCornerImage;
-
     QPoint m_tabBarNewTabButtonPosition;
-    QString m_tabBarNewTabButtonStyleSheet;
     bool m_tabBarNewTabButtonIsAtEndOfTabs;
 
     bool m_tabBarCompact;
-    int m_tabBarLeft;
-    int m_tabBarRight;
+    int m_tabBarLeft = 0;
+    int m_tabBarRight = 0;
 
     QPoint m_tabBarCloseTabButtonPosition;
-    QString m_tabBarCloseTabButtonStyleSheet;
+
+    QFileSystemWatcher *m_watcher = nullptr;
+    QHash<QString, qint64> m_fileModified;
+    QTimer m_reloadTimer;
 };
 
+Q_DECLARE_OPERATORS_FOR_FLAGS(Skin::Sections)
+
 #endif
@@ -0,0 +1,75 @@
+/*
+  SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+  SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "skinbutton.h"
+#include "framescheduler.h"
+
+#include <QPainter>
+
+SkinButton::SkinButton(Skin *skin, Skin::Element up, Skin::Element over, Skin::Element down, QWidget *parent)
+    : QToolButton(parent)
+    , m_skin(skin)
+    , m_upElement(up)
+    , m_overElement(over)
+    , m_downElement(down)
+{
+    setFocusPolicy(Qt::NoFocus);
+    setCursor(Qt::ArrowCursor);
+}
+
+SkinButton::~SkinButton() = default;
+
+void SkinButton::applySkin()
+{
+    setFixedSize(sizeHint());
+
+    FrameScheduler::self()->scheduleUpdate(this);
+}
+
+QSize SkinButton::sizeHint() const
+{
+    return m_skin->elementSize(m_upElement);
+}
+
+QSize SkinButton::minimumSizeHint() const
+{
+    return sizeHint();
+}
+
+void SkinButton::paintEvent(QPaintEvent *)
+{
+    Skin::Element element = m_upElement;
+
+    // QToolButton keeps itself down while its menu is open.
+    if (isDown() || isChecked())
+        element = m_downElement;
+    else if (m_hovered)
+        element = m_overElement;
+
+    if (!m_skin->hasElement(element))
+        element = m_upElement;
+
+    QPainter painter(this);
+    m_skin->drawElement(painter, QPoint(0, 0), element);
+}
+
+void SkinButton::enterEvent(QEnterEvent *event)
+{
+    m_hovered = true;
+    FrameScheduler::self()->scheduleUpdate(this);
+
+    QToolButton::enterEvent(event);
+}
+
+void SkinButton::leaveEvent(QEvent *event)
+{
+    m_hovered = false;
+    FrameScheduler::self()->scheduleUpdate(this);
+
+    QToolButton::leaveEvent(event);
+}
+
+#include "moc_skinbutton.cpp"
@@ -0,0 +1,44 @@
+/*
+  SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+  SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#ifndef SKINBUTTON_H
+#define SKINBUTTON_H
+
+#include "skin.h"
+
+#include <QToolButton>
+
+// A button that paints the skin's up, over and down images itself instead of
+// going through the style sheet engine.
+class SkinButton : public QToolButton
+{
+    Q_OBJECT
+
+public:
+    explicit SkinButton(Skin *skin, Skin::Element up, Skin::Element over, Skin::Element down, QWidget *parent = nullptr);
+    ~SkinButton() override;
+
+    void applySkin();
+
+    QSize sizeHint() const override;
+    QSize minimumSizeHint() const override;
+
+protected:
+    void paintEvent(QPaintEvent *) override;
+    void enterEvent(QEnterEvent *) override;
+    void leaveEvent(QEvent *) override;
+
+private:
+    Skin *m_skin = nullptr;
+
+    Skin::Element m_upElement;
+    Skin::Element m_overElement;
+    Skin::Element m_downElement;
+
+    bool m_hovered = false;
+};
+
+#endif
@@ -0,0 +1,57 @@
+/*
+  SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+  SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "skinpackage.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QResource>
+
+SkinPackage::SkinPackage(const QString &path)
+    : m_path(path)
+{
+    // The root is derived from the file and its modification time: stable
+    // across runs, so that the skin cache stays valid for an unchanged
+    // package, but distinct for a package that was replaced while the old
+    // version is still mounted.
+    const QByteArray key = (path + QLatin1Char('\n') + QString::number(QFileInfo(path).lastModified().toMSecsSinceEpoch())).toUtf8();
+    const QString root =
+        QStringLiteral("/yakuake/skin-packages/") + QString::fromLatin1(QCryptographicHash::hash(key, QCryptographicHash::Sha1).toHex());
+
+    if (QResource::registerResource(path, root))
+        m_root = root;
+}
+
+SkinPackage::~SkinPackage()
+{
+    if (!m_root.isEmpty())
+        QResource::unregisterResource(m_path, m_root);
+}
+
+bool SkinPackage::isPackage(const QString &path)
+{
+    QFile file(path);
+
+    return file.open(QIODevice::ReadOnly) && file.read(4) == "qres";
+}
+
+QString SkinPackage::skinId() const
+{
+    if (!isValid())
+        return QString();
+
+    const QDir root(this->root());
+    const QStringList dirs = root.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
+
+    for (const QString &dir : dirs) {
+        if (root.exists(dir + QStringLiteral("/title.skin")) && root.exists(dir + QStringLiteral("/tabs.skin")))
+            return dir;
+    }
+
+    return QString();
+}
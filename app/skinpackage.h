@@ -0,0 +1,51 @@
+/*
+  SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+  SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#ifndef SKINPACKAGE_H
+#define SKINPACKAGE_H
+
+#include <QString>
+
+// A skin shipped as a single compiled Qt resource file (<id>.rcc, built with
+// "rcc --binary" from a .qrc that lists <id>/title.skin, <id>/tabs.skin and
+// the images). Qt maps the file into memory while the package is mounted,
+// so loading it reads no loose files at all.
+class SkinPackage
+{
+public:
+    explicit SkinPackage(const QString &path);
+    ~SkinPackage();
+
+    static bool isPackage(const QString &path);
+
+    bool isValid() const
+    {
+        return !m_root.isEmpty();
+    }
+
+    const QString &path() const
+    {
+        return m_path;
+    }
+
+    // The resource path the package contents are mounted at, starting
+    // with ':' so that it can be used wherever a file name is accepted.
+    QString root() const
+    {
+        return QLatin1Char(':') + m_root;
+    }
+
+    // The first directory in the package that holds both descriptors.
+    QString skinId() const;
+
+private:
+    Q_DISABLE_COPY(SkinPackage)
+
+    QString m_path;
+    QString m_root;
+};
+
+#endif
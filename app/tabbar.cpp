@@ -6,11 +6,14 @@
 */
 
 #include "tabbar.h"
+#include "framescheduler.h"
 #include "mainwindow.h"
 #include "session.h"
+#include "sessionids.h"
 #include "sessionstack.h"
 #include "settings.h"
 #include "skin.h"
+#include "skinbutton.h"
 
 #include <KActionCollection>
 #include <KLocalizedString>
@@ -18,11 +21,11 @@
 #include <QApplication>
 #include <QDBusConnection>
 #include <QFontDatabase>
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <QLineEdit>
 #include <QMenu>
 #include <QPainter>
-#include <QPushButton>
-#include <QToolButton>
 #include <QWhatsThis>
 #include <QWheelEvent>
 
@@ -50,7 +53,7 @@ TabBar::TabBar(MainWindow *mainWindow)
     m_mainWindow = mainWindow;
 
     m_skin = mainWindow->skin();
-    connect(m_skin, SIGNAL(iconChanged()), this, SLOT(repaint()));
+    connect(m_skin, &Skin::iconChanged, this, &TabBar::scheduleRepaint);
 
     m_tabContextMenu = new QMenu(this);
     connect(m_tabContextMenu, SIGNAL(hovered(QAction *)), this, SLOT(contextMenuActionHovered(QAction *)));
@@ -62,16 +65,14 @@ TabBar::TabBar(MainWindow *mainWindow)
     m_sessionMenu = new QMenu(this);
     connect(m_sessionMenu, SIGNAL(aboutToShow()), this, SLOT(readySessionMenu()));
 
-    m_newTabButton = new QToolButton(this);
-    m_newTabButton->setFocusPolicy(Qt::NoFocus);
+    m_newTabButton = new SkinButton(m_skin, Skin::TabBarNewTabButtonUp, Skin::TabBarNewTabButtonOver, Skin::TabBarNewTabButtonDown, this);
     m_newTabButton->setMenu(m_sessionMenu);
     m_newTabButton->setPopupMode(QToolButton::DelayedPopup);
     m_newTabButton->setToolTip(xi18nc("@info:tooltip", "New Session"));
     m_newTabButton->setWhatsThis(xi18nc("@info:whatsthis", "Adds a new session. Press and hold to select session type from menu."));
     connect(m_newTabButton, SIGNAL(clicked()), this, SIGNAL(newTabRequested()));
 
-    m_closeTabButton = new QPushButton(this);
-    m_closeTabButton->setFocusPolicy(Qt::NoFocus);
+    m_closeTabButton = new SkinButton(m_skin, Skin::TabBarCloseTabButtonUp, Skin::TabBarCloseTabButtonOver, Skin::TabBarCloseTabButtonDown, this);
     m_closeTabButton->setToolTip(xi18nc("@info:tooltip", "Close Session"));
     m_closeTabButton->setWhatsThis(xi18nc("@info:whatsthis", "Closes the active session."));
     connect(m_closeTabButton, SIGNAL(clicked()), this, SLOT(closeTabButtonClicked()));
@@ -94,14 +95,14 @@ TabBar::~TabBar()
 
 void TabBar::applySkin()
 {
-    resize(width(), m_skin->tabBarBackgroundImage().height());
+    resize(width(), m_skin->elementSize(Skin::TabBarBackground).height());
 
-    m_newTabButton->setStyleSheet(m_skin->tabBarNewTabButtonStyleSheet());
-    m_closeTabButton->setStyleSheet(m_skin->tabBarCloseTabButtonStyleSheet());
+    m_newTabButton->applySkin();
+    m_closeTabButton->applySkin();
 
     moveNewTabButton();
     m_closeTabButton->move(width() - m_skin->tabBarCloseTabButtonPosition().x(), m_skin->tabBarCloseTabButtonPosition().y());
-    repaint();
+    scheduleRepaint();
 }
 
 void TabBar::readyTabContextMenu()
@@ -122,6 +123,8 @@ void TabBar::readyTabContextMenu()
         m_tabContextMenu->addSeparator();
         m_tabContextMenu->addAction(m_mainWindow->actionCollection()->action(QStringLiteral("close-active-terminal")));
         m_tabContextMenu->addAction(m_mainWindow->actionCollection()->action(QStringLiteral("close-session")));
+        m_tabContextMenu->addAction(m_mainWindow->actionCollection()->action(QStringLiteral("close-other-sessions")));
+        m_tabContextMenu->addAction(m_mainWindow->actionCollection()->action(QStringLiteral("close-sessions-to-the-right")));
     }
 }
 
@@ -152,6 +155,15 @@ void TabBar::updateMoveActions(int index)
         m_mainWindow->actionCollection()->action(QStringLiteral("move-session-right"))->setEnabled(true);
 }
 
+void TabBar::updateCloseActions(int index)
+{
+    if (index == -1)
+        return;
+
+    m_mainWindow->actionCollection()->action(QStringLiteral("close-other-sessions"))->setEnabled(m_tabs.count() > 1);
+    m_mainWindow->actionCollection()->action(QStringLiteral("close-sessions-to-the-right"))->setEnabled(index < m_tabs.count() - 1);
+}
+
 void TabBar::updateToggleActions(int sessionId)
 {
     if (sessionId == -1)
@@ -334,6 +346,7 @@ void TabBar::contextMenuEvent(QContextMenuEvent *event)
         readyTabContextMenu();
 
         updateMoveActions(index);
+        updateCloseActions(index);
 
         int sessionId = sessionAtTab(index);
         updateToggleActions(sessionId);
@@ -357,6 +370,7 @@ void TabBar::contextMenuEvent(QContextMenuEvent *event)
         m_mainWindow->setContextDependentActionsQuiet(false);
 
         updateMoveActions(m_tabs.indexOf(m_selectedSessionId));
+        updateCloseActions(m_tabs.indexOf(m_selectedSessionId));
         updateToggleActions(m_selectedSessionId);
         updateToggleKeyboardInputMenu(m_selectedSessionId);
         updateToggleMonitorActivityMenu(m_selectedSessionId);
@@ -375,6 +389,8 @@ void TabBar::resizeEvent(QResizeEvent *event)
 
 void TabBar::moveNewTabButton()
 {
+    ensureTabWidths();
+
     int newTabButtonX = m_skin->tabBarNewTabButtonPosition().x();
     if (m_skin->tabBarNewTabButtonIsAtEndOfTabs() && !m_tabWidths.isEmpty()) {
         newTabButtonX += m_tabWidths.last();
@@ -390,18 +406,18 @@ void TabBar::paintEvent(QPaintEvent *)
     int x = m_skin->tabBarPosition().x();
     int y = m_skin->tabBarPosition().y();
     m_tabWidths.clear();
+    m_tabWidthsDirty = false;
 
     QRect tabsClipRect(x, y, m_closeTabButton->x() - x, height() - y);
     painter.setClipRect(tabsClipRect);
 
     for (int index = 0; index < m_tabs.count(); ++index) {
-        x = drawTab(x, y, index, painter);
+        x = drawTab(x, y, index, &painter);
         m_tabWidths << x;
     }
 
-    const QPixmap &backgroundImage = m_skin->tabBarBackgroundImage();
-    const QPixmap &leftCornerImage = m_skin->tabBarLeftCornerImage();
-    const QPixmap &rightCornerImage = m_skin->tabBarRightCornerImage();
+    const int leftCornerWidth = m_skin->elementSize(Skin::TabBarLeftCorner).width();
+    const int rightCornerWidth = m_skin->elementSize(Skin::TabBarRightCorner).width();
 
     x = x > tabsClipRect.right() ? tabsClipRect.right() + 1 : x;
 
@@ -412,17 +428,17 @@ void TabBar::paintEvent(QPaintEvent *)
     backgroundClipRegion = backgroundClipRegion.subtracted(tabsRect);
     painter.setClipRegion(backgroundClipRegion);
 
-    painter.drawImage(0, 0, leftCornerImage.toImage());
-    QRect leftCornerImageRect(0, 0, leftCornerImage.width(), height());
+    m_skin->drawElement(painter, QPoint(0, 0), Skin::TabBarLeftCorner);
+    QRect leftCornerImageRect(0, 0, leftCornerWidth, height());
     backgroundClipRegion = backgroundClipRegion.subtracted(leftCornerImageRect);
 
-    painter.drawImage(width() - rightCornerImage.width(), 0, rightCornerImage.toImage());
-    QRect rightCornerImageRect(width() - rightCornerImage.width(), 0, rightCornerImage.width(), height());
+    m_skin->drawElement(painter, QPoint(width() - rightCornerWidth, 0), Skin::TabBarRightCorner);
+    QRect rightCornerImageRect(width() - rightCornerWidth, 0, rightCornerWidth, height());
     backgroundClipRegion = backgroundClipRegion.subtracted(rightCornerImageRect);
 
     painter.setClipRegion(backgroundClipRegion);
 
-    painter.drawTiledPixmap(0, 0, width(), height(), backgroundImage);
+    painter.drawTiledPixmap(0, 0, width(), height(), m_skin->tabBarBackgroundImage());
 
     painter.end();
 
@@ -431,7 +447,41 @@ void TabBar::paintEvent(QPaintEvent *)
     }
 }
 
-int TabBar::drawTab(int x, int y, int index, QPainter &painter)
+void TabBar::updateTabWidths()
+{
+    int x = m_skin->tabBarPosition().x();
+    int y = m_skin->tabBarPosition().y();
+    m_tabWidths.clear();
+    m_tabWidthsDirty = false;
+
+    for (int index = 0; index < m_tabs.count(); ++index) {
+        x = drawTab(x, y, index, nullptr);
+        m_tabWidths << x;
+    }
+
+    if (m_skin->tabBarNewTabButtonIsAtEndOfTabs()) {
+        moveNewTabButton();
+    }
+}
+
+void TabBar::scheduleRepaint()
+{
+    // The tabs are measured again when painted, or earlier if hit testing
+    // or renaming needs their geometry first.
+    m_tabWidthsDirty = true;
+
+    FrameScheduler::self()->scheduleUpdate(this);
+}
+
+void TabBar::ensureTabWidths()
+{
+    if (m_tabWidthsDirty)
+        updateTabWidths();
+}
+
+// Lays out the tab at index starting at x and returns its right edge. Only
+// measures when painter is null.
+int TabBar::drawTab(int x, int y, int index, QPainter *painter)
 {
     QString title;
     int sessionId;
@@ -444,14 +494,17 @@ int TabBar::drawTab(int x, int y, int index, QPainter &painter)
     title = m_tabTitles[sessionId];
 
     if (selected) {
-        painter.drawPixmap(x, y, m_skin->tabBarSelectedLeftCornerImage());
-        x += m_skin->tabBarSelectedLeftCornerImage().width();
-    } else if (!m_skin->tabBarUnselectedLeftCornerImage().isNull()) {
-        painter.drawPixmap(x, y, m_skin->tabBarUnselectedLeftCornerImage());
-        x += m_skin->tabBarUnselectedLeftCornerImage().width();
+        if (painter)
+            m_skin->drawElement(*painter, QPoint(x, y), Skin::TabBarSelectedLeftCorner);
+        x += m_skin->elementSize(Skin::TabBarSelectedLeftCorner).width();
+    } else if (m_skin->hasElement(Skin::TabBarUnselectedLeftCorner)) {
+        if (painter)
+            m_skin->drawElement(*painter, QPoint(x, y), Skin::TabBarUnselectedLeftCorner);
+        x += m_skin->elementSize(Skin::TabBarUnselectedLeftCorner).width();
     } else if (index != m_tabs.indexOf(m_selectedSessionId) + 1) {
-        painter.drawPixmap(x, y, m_skin->tabBarSeparatorImage());
-        x += m_skin->tabBarSeparatorImage().width();
+        if (painter)
+            m_skin->drawElement(*painter, QPoint(x, y), Skin::TabBarSeparator);
+        x += m_skin->elementSize(Skin::TabBarSeparator).width();
     }
 
     if (selected)
@@ -459,52 +512,60 @@ int TabBar::drawTab(int x, int y, int index, QPainter &painter)
     else
         font.setBold(false);
 
-    painter.setFont(font);
+    if (painter)
+        painter->setFont(font);
 
     QFontMetrics fontMetrics(font);
     textWidth = fontMetrics.horizontalAdvance(title) + 10;
 
     // Draw the Prevent Closing image in the tab button.
     if (m_mainWindow->sessionStack()->isSessionClosable(sessionId) == false) {
-        if (selected)
-            painter.drawTiledPixmap(x,
-                                    y,
-                                    m_skin->tabBarPreventClosingImagePosition().x() + m_skin->tabBarPreventClosingImage().width(),
-                                    height(),
-                                    m_skin->tabBarSelectedBackgroundImage());
-        else
-            painter.drawTiledPixmap(x,
-                                    y,
-                                    m_skin->tabBarPreventClosingImagePosition().x() + m_skin->tabBarPreventClosingImage().width(),
-                                    height(),
-                                    m_skin->tabBarUnselectedBackgroundImage());
-
-        painter.drawPixmap(x + m_skin->tabBarPreventClosingImagePosition().x(),
-                           m_skin->tabBarPreventClosingImagePosition().y(),
-                           m_skin->tabBarPreventClosingImage());
+        if (painter) {
+            if (selected)
+                painter->drawTiledPixmap(x,
+                                         y,
+                                         m_skin->tabBarPreventClosingImagePosition().x() + m_skin->elementSize(Skin::TabBarPreventClosing).width(),
+                                         height(),
+                                         m_skin->tabBarSelectedBackgroundImage());
+            else
+                painter->drawTiledPixmap(x,
+                                         y,
+                                         m_skin->tabBarPreventClosingImagePosition().x() + m_skin->elementSize(Skin::TabBarPreventClosing).width(),
+                                         height(),
+                                         m_skin->tabBarUnselectedBackgroundImage());
+
+            m_skin->drawElement(*painter,
+                                QPoint(x + m_skin->tabBarPreventClosingImagePosition().x(), m_skin->tabBarPreventClosingImagePosition().y()),
+                                Skin::TabBarPreventClosing);
+        }
 
         x += m_skin->tabBarPreventClosingImagePosition().x();
-        x += m_skin->tabBarPreventClosingImage().width();
+        x += m_skin->elementSize(Skin::TabBarPreventClosing).width();
     }
 
-    if (selected)
-        painter.drawTiledPixmap(x, y, textWidth, height(), m_skin->tabBarSelectedBackgroundImage());
-    else
-        painter.drawTiledPixmap(x, y, textWidth, height(), m_skin->tabBarUnselectedBackgroundImage());
+    if (painter) {
+        if (selected)
+            painter->drawTiledPixmap(x, y, textWidth, height(), m_skin->tabBarSelectedBackgroundImage());
+        else
+            painter->drawTiledPixmap(x, y, textWidth, height(), m_skin->tabBarUnselectedBackgroundImage());
 
-    painter.drawText(x, y, textWidth + 1, height() + 2, Qt::AlignHCenter | Qt::AlignVCenter, title);
+        painter->drawText(x, y, textWidth + 1, height() + 2, Qt::AlignHCenter | Qt::AlignVCenter, title);
+    }
 
     x += textWidth;
 
     if (selected) {
-        painter.drawPixmap(x, m_skin->tabBarPosition().y(), m_skin->tabBarSelectedRightCornerImage());
-        x += m_skin->tabBarSelectedRightCornerImage().width();
-    } else if (!m_skin->tabBarUnselectedRightCornerImage().isNull()) {
-        painter.drawPixmap(x, m_skin->tabBarPosition().y(), m_skin->tabBarUnselectedRightCornerImage());
-        x += m_skin->tabBarUnselectedRightCornerImage().width();
+        if (painter)
+            m_skin->drawElement(*painter, QPoint(x, m_skin->tabBarPosition().y()), Skin::TabBarSelectedRightCorner);
+        x += m_skin->elementSize(Skin::TabBarSelectedRightCorner).width();
+    } else if (m_skin->hasElement(Skin::TabBarUnselectedRightCorner)) {
+        if (painter)
+            m_skin->drawElement(*painter, QPoint(x, m_skin->tabBarPosition().y()), Skin::TabBarUnselectedRightCorner);
+        x += m_skin->elementSize(Skin::TabBarUnselectedRightCorner).width();
     } else if (index != m_tabs.indexOf(m_selectedSessionId) - 1) {
-        painter.drawPixmap(x, m_skin->tabBarPosition().y(), m_skin->tabBarSeparatorImage());
-        x += m_skin->tabBarSeparatorImage().width();
+        if (painter)
+            m_skin->drawElement(*painter, QPoint(x, m_skin->tabBarPosition().y()), Skin::TabBarSeparator);
+        x += m_skin->elementSize(Skin::TabBarSeparator).width();
     }
 
     return x;
@@ -512,6 +573,8 @@ int TabBar::drawTab(int x, int y, int index, QPainter &painter)
 
 int TabBar::tabAt(int x)
 {
+    ensureTabWidths();
+
     for (int index = 0; index < m_tabWidths.count(); ++index) {
         if (x > m_skin->tabBarPosition().x() && x < m_tabWidths.at(index))
             return index;
@@ -669,6 +732,7 @@ void TabBar::dropEvent(QDropEvent *event)
             --targetIndex;
 
         m_tabs.move(sourceIndex, targetIndex);
+        Q_EMIT tabsReordered();
         Q_EMIT tabSelected(m_tabs.at(targetIndex));
 
         event->accept();
@@ -755,6 +819,8 @@ void TabBar::interactiveRename(int sessionId)
 
     m_renamingSessionId = sessionId;
 
+    ensureTabWidths();
+
     int index = m_tabs.indexOf(sessionId);
     int x = index ? m_tabWidths.at(index - 1) : m_skin->tabBarPosition().x();
     int y = m_skin->tabBarPosition().y();
@@ -784,9 +850,10 @@ void TabBar::selectTab(int sessionId)
     m_selectedSessionId = sessionId;
 
     updateMoveActions(m_tabs.indexOf(sessionId));
+    updateCloseActions(m_tabs.indexOf(sessionId));
     updateToggleActions(sessionId);
 
-    repaint();
+    scheduleRepaint();
 }
 
 void TabBar::selectNextTab()
@@ -830,10 +897,12 @@ void TabBar::moveTabLeft(int sessionId)
         return;
 
     m_tabs.swapItemsAt(index, index - 1);
+    Q_EMIT tabsReordered();
 
-    repaint();
+    scheduleRepaint();
 
     updateMoveActions(index - 1);
+    updateCloseActions(index - 1);
 }
 
 void TabBar::moveTabRight(int sessionId)
@@ -847,10 +916,12 @@ void TabBar::moveTabRight(int sessionId)
         return;
 
     m_tabs.swapItemsAt(index, index + 1);
+    Q_EMIT tabsReordered();
 
-    repaint();
+    scheduleRepaint();
 
     updateMoveActions(index + 1);
+    updateCloseActions(index + 1);
 }
 
 void TabBar::closeTabButtonClicked()
@@ -868,12 +939,22 @@ QString TabBar::tabTitle(int sessionId)
 
 void TabBar::setTabTitle(int sessionId, const QString &newTitle, InteractiveType interactive)
 {
-    if (sessionId == -1)
+    if (!updateTabTitle(sessionId, newTitle, interactive))
         return;
+
+    Q_EMIT tabTitleEdited(sessionId, newTitle);
+    scheduleRepaint();
+}
+
+// Stores a title without repainting; returns whether it was taken.
+bool TabBar::updateTabTitle(int sessionId, const QString &newTitle, InteractiveType interactive)
+{
+    if (sessionId == -1)
+        return false;
     if (!m_tabTitles.contains(sessionId))
-        return;
+        return false;
     if (!interactive && m_tabTitlesSetInteractive.value(sessionId, false))
-        return;
+        return false;
     if (interactive)
         m_tabTitlesSetInteractive[sessionId] = interactive;
 
@@ -882,15 +963,63 @@ void TabBar::setTabTitle(int sessionId, const QString &newTitle, InteractiveType
     } else
         m_tabTitlesSetInteractive.remove(sessionId);
 
-    Q_EMIT tabTitleEdited(sessionId, newTitle);
-    update();
+    return true;
 }
 
 void TabBar::setTabTitleAutomated(int sessionId, const QString &newTitle)
 {
+    if (!newTitle.isEmpty() && m_tabTitles.value(sessionId) == newTitle)
+        return;
+
     setTabTitle(sessionId, newTitle, NonInteractive);
 }
 
+// Sets the titles of many tabs at once from a JSON object mapping session
+// ids to titles, laying out and repainting the tab bar only once.
+void TabBar::setTabTitles(const QString &titles)
+{
+    const QJsonObject titlesObject = QJsonDocument::fromJson(titles.toUtf8()).object();
+
+    QList<int> sessionIds;
+
+    for (auto it = titlesObject.constBegin(); it != titlesObject.constEnd(); ++it) {
+        bool ok = false;
+        const int sessionId = it.key().toInt(&ok);
+
+        if (ok && updateTabTitle(sessionId, it.value().toString(), Interactive))
+            sessionIds << sessionId;
+    }
+
+    if (sessionIds.isEmpty())
+        return;
+
+    Q_EMIT tabTitlesEdited(sessionIds);
+    scheduleRepaint();
+}
+
+// Applies a complete tab order given as a comma-separated permutation of
+// the current session ids.
+bool TabBar::setTabOrder(const QString &sessionIds)
+{
+    QList<int> tabs;
+
+    if (!SessionIds::parse(sessionIds, tabs) || !SessionIds::isPermutation(tabs, m_tabs))
+        return false;
+
+    if (tabs == m_tabs)
+        return true;
+
+    m_tabs = tabs;
+    Q_EMIT tabsReordered();
+
+    scheduleRepaint();
+
+    updateMoveActions(m_tabs.indexOf(m_selectedSessionId));
+    updateCloseActions(m_tabs.indexOf(m_selectedSessionId));
+
+    return true;
+}
+
 int TabBar::sessionAtTab(int index)
 {
     if (index < 0 || index > m_tabs.count() - 1)
@@ -953,6 +1082,8 @@ void TabBar::startDrag(int index)
     m_startPos.setX(0);
     m_startPos.setY(0);
 
+    ensureTabWidths();
+
     int x = index ? m_tabWidths.at(index - 1) : m_skin->tabBarPosition().x();
     int tabWidth = m_tabWidths.at(index) - x;
 
@@ -968,7 +1099,7 @@ void TabBar::startDrag(int index)
     painter.begin(this);
     painter.setPen(m_skin->tabBarTextColor());
 
-    drawTab(0, 0, index, painter);
+    drawTab(0, 0, index, &painter);
     painter.end();
 
     QMimeData *mimeData = new QMimeData;
@@ -1005,6 +1136,8 @@ void TabBar::drawDropIndicator(int index, bool disabled)
     else
         temp_index = index;
 
+    ensureTabWidths();
+
     int x = temp_index ? m_tabWidths.at(temp_index - 1) : m_skin->tabBarPosition().x();
     int tabWidth = m_tabWidths.at(temp_index) - x;
     int y = m_skin->tabBarPosition().y();
@@ -16,11 +16,10 @@
 
 class MainWindow;
 class Skin;
+class SkinButton;
 
 class QLineEdit;
 class QMenu;
-class QPushButton;
-class QToolButton;
 class QLabel;
 
 class TabBar : public QWidget
@@ -38,6 +37,16 @@ public:
 
     void applySkin();
 
+    QList<int> sessionIds() const
+    {
+        return m_tabs;
+    }
+
+    bool isTabTitleInteractive(int sessionId) const
+    {
+        return m_tabTitlesSetInteractive.value(sessionId, false);
+    }
+
 public Q_SLOTS:
     void addTab(int sessionId, const QString &title);
     void removeTab(int sessionId = -1);
@@ -54,9 +63,14 @@ public Q_SLOTS:
     Q_SCRIPTABLE QString tabTitle(int sessionId);
     Q_SCRIPTABLE void setTabTitle(int sessionId, const QString &newTitle, InteractiveType interactive = Interactive);
     void setTabTitleAutomated(int sessionId, const QString &newTitle);
+    Q_SCRIPTABLE void setTabTitles(const QString &titles);
+
+    Q_SCRIPTABLE bool setTabOrder(const QString &sessionIds);
 
     Q_SCRIPTABLE int sessionAtTab(int index);
 
+    void scheduleRepaint();
+
 Q_SIGNALS:
     void newTabRequested();
     void tabSelected(int sessionId);
@@ -67,6 +81,8 @@ Q_SIGNALS:
     void tabContextMenuClosed();
     void lastTabClosed();
     void tabTitleEdited(int sessionId, QString title);
+    void tabTitlesEdited(const QList<int> &sessionIds);
+    void tabsReordered();
 
 protected:
     void resizeEvent(QResizeEvent *) override;
@@ -97,16 +113,20 @@ private:
     QString standardTabTitle(Session::SessionContent contentType);
     QString makeTabTitle(int number, Session::SessionContent contentType);
     int tabAt(int x);
+    bool updateTabTitle(int sessionId, const QString &newTitle, InteractiveType interactive);
 
     void readyTabContextMenu();
 
     void updateMoveActions(int index);
+    void updateCloseActions(int index);
     void updateToggleActions(int sessionId);
     void updateToggleKeyboardInputMenu(int sessionId = -1);
     void updateToggleMonitorSilenceMenu(int sessionId = -1);
     void updateToggleMonitorActivityMenu(int sessionId = -1);
 
-    int drawTab(int x, int y, int index, QPainter &painter);
+    void updateTabWidths();
+    void ensureTabWidths();
+    int drawTab(int x, int y, int index, QPainter *painter);
     void moveNewTabButton();
 
     void startDrag(int index);
@@ -117,8 +137,8 @@ private:
     MainWindow *m_mainWindow = nullptr;
     Skin *m_skin = nullptr;
 
-    QToolButton *m_newTabButton = nullptr;
-    QPushButton *m_closeTabButton = nullptr;
+    SkinButton *m_newTabButton = nullptr;
+    SkinButton *m_closeTabButton = nullptr;
 
     QMenu *m_tabContextMenu = nullptr;
     QMenu *m_toggleKeyboardInputMenu = nullptr;
@@ -133,6 +153,7 @@ private:
     QHash<int, QString> m_tabTitles;
     QHash<int, bool> m_tabTitlesSetInteractive;
     QList<int> m_tabWidths;
+    bool m_tabWidthsDirty = true;
 
     int m_selectedSessionId;
 
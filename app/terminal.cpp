@@ -5,6 +5,7 @@
 */
 
 #include "terminal.h"
+#include "contentregistry.h"
 #include "settings.h"
 
 #include <KActionCollection>
@@ -23,13 +24,10 @@
 
 #include <QKeyEvent>
 
-int Terminal::m_availableTerminalId = 0;
-
 Terminal::Terminal(const QString &workingDir, QWidget *parent)
     : QObject(nullptr)
 {
-    m_terminalId = m_availableTerminalId;
-    m_availableTerminalId++;
+    m_terminalId = ContentRegistry::self()->allocateId();
     m_parentSplitter = parent;
 
     KPluginMetaData part(QStringLiteral("kf6/parts/konsolepart"));
@@ -101,6 +99,9 @@ Terminal::Terminal(const QString &workingDir, QWidget *parent)
 Terminal::~Terminal()
 {
     m_destroying = true;
+
+    ContentRegistry::self()->remove(m_terminalId);
+
     // The ownership of m_part is a mess
     // When the terminal exits, e.g. the user pressed Ctrl+D, the part deletes itself
     // When we close a terminal we need to delete the part ourselves
@@ -233,14 +234,34 @@ void Terminal::disableOffendingPartActions()
 
 void Terminal::setTitle(const QString &title)
 {
+    if (title == m_title)
+        return;
+
     m_title = title;
 
     Q_EMIT titleChanged(m_terminalId, m_title);
 }
 
-void Terminal::runCommand(const QString &command)
+bool Terminal::runCommand(const QString &command)
 {
+    if (!m_terminalInterface)
+        return false;
+
     m_terminalInterface->sendInput(command + QStringLiteral("\n"));
+
+    return true;
+}
+
+bool Terminal::setProfile(const QString &profileName)
+{
+    if (!m_part)
+        return false;
+
+    bool changed = false;
+
+    QMetaObject::invokeMethod(m_part, "setCurrentProfile", Qt::DirectConnection, Q_RETURN_ARG(bool, changed), Q_ARG(QString, profileName));
+
+    return changed;
 }
 
 void Terminal::manageProfiles()
@@ -300,6 +321,9 @@ void Terminal::silenceDetected()
 
 QString Terminal::currentWorkingDirectory() const
 {
+    if (!m_terminalInterface)
+        return QString();
+
     return m_terminalInterface->currentWorkingDirectory();
 }
 
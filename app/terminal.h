@@ -53,10 +53,11 @@ public:
         m_parentSplitter = splitter;
     }
 
-    void runCommand(const QString &command);
+    bool runCommand(const QString &command);
 
     void manageProfiles();
     void editProfile();
+    bool setProfile(const QString &profileName);
 
     bool keyboardInputEnabled() const
     {
@@ -120,7 +121,6 @@ private:
 
     void displayKPartLoadError();
 
-    static int m_availableTerminalId;
     int m_terminalId;
 
     KParts::Part *m_part = nullptr;
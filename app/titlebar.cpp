@@ -6,15 +6,18 @@
 */
 
 #include "titlebar.h"
+#include "framescheduler.h"
 #include "mainwindow.h"
 #include "skin.h"
+#include "skinbutton.h"
 
 #include <KLocalizedString>
 #include <QFontDatabase>
-#include <QPushButton>
 
 #include <QBitmap>
+#include <QPaintEvent>
 #include <QPainter>
+#include <QtMath>
 
 TitleBar::TitleBar(MainWindow *mainWindow)
     : QWidget(mainWindow)
@@ -30,27 +33,24 @@ TitleBar::TitleBar(MainWindow *mainWindow)
 
     setCursor(Qt::SizeVerCursor);
 
-    m_focusButton = new QPushButton(this);
-    m_focusButton->setFocusPolicy(Qt::NoFocus);
+    m_focusButton = new SkinButton(m_skin, Skin::TitleBarFocusButtonUp, Skin::TitleBarFocusButtonOver, Skin::TitleBarFocusButtonDown, this);
     m_focusButton->setCheckable(true);
     m_focusButton->setToolTip(xi18nc("@info:tooltip", "Keep window open when it loses focus"));
     m_focusButton->setWhatsThis(xi18nc("@info:whatsthis", "If this is checked, the window will stay open when it loses focus."));
-    m_focusButton->setCursor(Qt::ArrowCursor);
     connect(m_focusButton, SIGNAL(toggled(bool)), mainWindow, SLOT(setKeepOpen(bool)));
 
-    m_menuButton = new QPushButton(this);
-    m_menuButton->setFocusPolicy(Qt::NoFocus);
+    m_menuButton = new SkinButton(m_skin, Skin::TitleBarMenuButtonUp, Skin::TitleBarMenuButtonOver, Skin::TitleBarMenuButtonDown, this);
     m_menuButton->setMenu(mainWindow->menu());
+    m_menuButton->setPopupMode(QToolButton::InstantPopup);
     m_menuButton->setToolTip(xi18nc("@info:tooltip", "Open Menu"));
     m_menuButton->setWhatsThis(xi18nc("@info:whatsthis", "Opens the main menu."));
-    m_menuButton->setCursor(Qt::ArrowCursor);
 
-    m_quitButton = new QPushButton(this);
-    m_quitButton->setFocusPolicy(Qt::NoFocus);
+    m_quitButton = new SkinButton(m_skin, Skin::TitleBarQuitButtonUp, Skin::TitleBarQuitButtonOver, Skin::TitleBarQuitButtonDown, this);
     m_quitButton->setToolTip(xi18nc("@info:tooltip Quits the application", "Quit"));
     m_quitButton->setWhatsThis(xi18nc("@info:whatsthis", "Quits the application."));
-    m_quitButton->setCursor(Qt::ArrowCursor);
     connect(m_quitButton, SIGNAL(clicked()), mainWindow, SLOT(close()));
+
+    m_titleText.setTextFormat(Qt::PlainText);
 }
 
 TitleBar::~TitleBar() = default;
@@ -59,7 +59,7 @@ void TitleBar::setVisible(bool visible)
 {
     m_visible = visible;
     if (m_visible) {
-        resize(width(), m_skin->titleBarBackgroundImage().height());
+        resize(width(), m_skin->elementSize(Skin::TitleBarBackground).height());
     } else {
         resize(width(), 0);
     }
@@ -69,19 +69,31 @@ void TitleBar::setVisible(bool visible)
 
 void TitleBar::applySkin()
 {
-    resize(width(), m_visible ? m_skin->titleBarBackgroundImage().height() : 0);
+    resize(width(), m_visible ? m_skin->elementSize(Skin::TitleBarBackground).height() : 0);
 
-    m_focusButton->setStyleSheet(m_skin->titleBarFocusButtonStyleSheet());
-    m_menuButton->setStyleSheet(m_skin->titleBarMenuButtonStyleSheet());
-    m_quitButton->setStyleSheet(m_skin->titleBarQuitButtonStyleSheet());
+    m_focusButton->applySkin();
+    m_menuButton->applySkin();
+    m_quitButton->applySkin();
 
     moveButtons();
 
-    repaint();
+    m_backgroundCache = QPixmap();
+    updateTitleFont();
+
+    FrameScheduler::self()->scheduleUpdate(this);
 
     updateMask();
 }
 
+qint64 TitleBar::releaseCaches()
+{
+    const qint64 bytes = qint64(m_backgroundCache.width()) * m_backgroundCache.height() * m_backgroundCache.depth() / 8;
+
+    m_backgroundCache = QPixmap();
+
+    return bytes;
+}
+
 void TitleBar::moveButtons()
 {
     if (m_skin->titleBarFocusButtonAnchor() == Qt::AnchorLeft)
@@ -104,38 +116,78 @@ void TitleBar::resizeEvent(QResizeEvent *event)
 {
     moveButtons();
 
+    if (event->size().width() != event->oldSize().width())
+        m_backgroundCache = QPixmap();
+
+    updateTitleLayout();
+
     updateMask();
 
     QWidget::resizeEvent(event);
 }
 
-void TitleBar::paintEvent(QPaintEvent *)
+void TitleBar::paintEvent(QPaintEvent *event)
 {
+    if (m_backgroundCache.isNull() || m_backgroundCache.deviceIndependentSize().toSize() != size()
+        || m_backgroundCache.devicePixelRatio() != devicePixelRatioF())
+        renderBackground();
+
     QPainter painter(this);
-    painter.setPen(m_skin->titleBarTextColor());
+    painter.setClipRegion(event->region());
+
+    painter.drawPixmap(0, 0, m_backgroundCache);
+
+    if (m_titleRect.intersects(event->rect())) {
+        painter.setPen(m_skin->titleBarTextColor());
+        painter.setFont(m_titleFont);
+        painter.drawStaticText(m_titlePosition, m_titleText);
+    }
+
+    painter.end();
+}
+
+void TitleBar::renderBackground()
+{
+    const qreal devicePixelRatio = devicePixelRatioF();
 
-    const QPixmap &backgroundImage = m_skin->titleBarBackgroundImage();
-    const QPixmap &leftCornerImage = m_skin->titleBarLeftCornerImage();
-    const QPixmap &rightCornerImage = m_skin->titleBarRightCornerImage();
+    m_backgroundCache = QPixmap(size() * devicePixelRatio);
+    m_backgroundCache.setDevicePixelRatio(devicePixelRatio);
+    m_backgroundCache.fill(Qt::transparent);
 
-    painter.drawTiledPixmap(leftCornerImage.width(), 0, width() - leftCornerImage.width() - rightCornerImage.width(), height(), backgroundImage);
+    QPainter painter(&m_backgroundCache);
 
-    painter.drawPixmap(0, 0, leftCornerImage);
-    painter.drawPixmap(width() - rightCornerImage.width(), 0, rightCornerImage);
+    const int leftCornerWidth = m_skin->elementSize(Skin::TitleBarLeftCorner).width();
+    const int rightCornerWidth = m_skin->elementSize(Skin::TitleBarRightCorner).width();
 
-    QFont font = QFontDatabase::systemFont(QFontDatabase::TitleFont);
-    font.setBold(m_skin->titleBarTextBold());
-    painter.setFont(font);
+    painter.drawTiledPixmap(leftCornerWidth, 0, width() - leftCornerWidth - rightCornerWidth, height(), m_skin->titleBarBackgroundImage());
+
+    m_skin->drawElement(painter, QPoint(0, 0), Skin::TitleBarLeftCorner);
+    m_skin->drawElement(painter, QPoint(width() - rightCornerWidth, 0), Skin::TitleBarRightCorner);
+}
+
+void TitleBar::updateTitleFont()
+{
+    m_titleFont = QFontDatabase::systemFont(QFontDatabase::TitleFont);
+    m_titleFont.setBold(m_skin->titleBarTextBold());
+
+    updateTitleLayout();
+}
+
+void TitleBar::updateTitleLayout()
+{
+    m_titleText.setText(title());
+    m_titleText.prepare(QTransform(), m_titleFont);
+
+    const QFontMetrics fontMetrics(m_titleFont);
+    const int textWidth = qCeil(m_titleText.size().width());
 
-    const QString titleAsString = this->title();
     if (m_skin->titleBarTextCentered()
-        && width() > m_skin->titleBarTextPosition().x() + painter.fontMetrics().horizontalAdvance(titleAsString) + m_focusButton->width()
-                + m_quitButton->width() + m_menuButton->width())
-        painter.drawText(0, 0, width(), height(), Qt::AlignCenter, titleAsString);
+        && width() > m_skin->titleBarTextPosition().x() + textWidth + m_focusButton->width() + m_quitButton->width() + m_menuButton->width())
+        m_titlePosition = QPoint((width() - textWidth) / 2, (height() - fontMetrics.height()) / 2);
     else
-        painter.drawText(m_skin->titleBarTextPosition(), titleAsString);
+        m_titlePosition = QPoint(m_skin->titleBarTextPosition().x(), m_skin->titleBarTextPosition().y() - fontMetrics.ascent());
 
-    painter.end();
+    m_titleRect = QRect(m_titlePosition, QSize(textWidth, fontMetrics.height()));
 }
 
 void TitleBar::mouseMoveEvent(QMouseEvent *event)
@@ -160,19 +212,31 @@ void TitleBar::mouseMoveEvent(QMouseEvent *event)
     }
 }
 
+// The title font is the system title font, not the widget font, so it is
+// picked up again when the application fonts change.
+bool TitleBar::event(QEvent *event)
+{
+    if (event->type() == QEvent::ApplicationFontChange) {
+        updateTitleFont();
+        FrameScheduler::self()->scheduleUpdate(this);
+    }
+
+    return QWidget::event(event);
+}
+
 void TitleBar::updateMask()
 {
-    const QPixmap &leftCornerImage = m_skin->titleBarLeftCornerImage();
-    const QPixmap &rightCornerImage = m_skin->titleBarRightCornerImage();
+    const int leftCornerWidth = m_skin->elementSize(Skin::TitleBarLeftCorner).width();
+    const int rightCornerWidth = m_skin->elementSize(Skin::TitleBarRightCorner).width();
 
-    QRegion leftCornerRegion = leftCornerImage.hasAlpha() ? QRegion(leftCornerImage.mask()) : QRegion(leftCornerImage.rect());
-    QRegion rightCornerRegion = rightCornerImage.hasAlpha() ? QRegion(rightCornerImage.mask()) : QRegion(rightCornerImage.rect());
+    QRegion leftCornerRegion = m_skin->elementMask(Skin::TitleBarLeftCorner);
+    QRegion rightCornerRegion = m_skin->elementMask(Skin::TitleBarRightCorner);
 
     QRegion mask = leftCornerRegion;
 
-    mask += QRegion(QRect(0, 0, width() - leftCornerImage.width() - rightCornerImage.width(), height())).translated(leftCornerImage.width(), 0);
+    mask += QRegion(QRect(0, 0, width() - leftCornerWidth - rightCornerWidth, height())).translated(leftCornerWidth, 0);
 
-    mask += rightCornerRegion.translated(width() - rightCornerImage.width(), 0);
+    mask += rightCornerRegion.translated(width() - rightCornerWidth, 0);
 
     setMask(mask);
 }
@@ -199,9 +263,17 @@ QString TitleBar::title() const
 
 void TitleBar::setTitle(const QString &title)
 {
+    if (title == m_title)
+        return;
+
     m_title = title;
 
-    repaint();
+    const QRect oldTitleRect = m_titleRect;
+
+    updateTitleLayout();
+
+    // Only the text area needs to be redrawn, the background comes from the cache.
+    FrameScheduler::self()->scheduleUpdate(this, oldTitleRect.united(m_titleRect));
 }
 
 #include "moc_titlebar.cpp"
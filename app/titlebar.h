@@ -9,12 +9,14 @@
 #define TITLEBAR_H
 
 #include <QMouseEvent>
+#include <QPixmap>
+#include <QStaticText>
 #include <QWidget>
 
 class MainWindow;
 class Skin;
+class SkinButton;
 
-class QPushButton;
 
 class TitleBar : public QWidget
 {
@@ -29,6 +31,10 @@ public:
     void updateMask();
     void updateMenu();
 
+    // Drops the rendered background until the next paint. Returns the number
+    // of bytes freed.
+    qint64 releaseCaches();
+
     QString title() const;
 
     void setFocusButtonState(bool checked);
@@ -40,19 +46,31 @@ protected:
     void resizeEvent(QResizeEvent *) override;
     void paintEvent(QPaintEvent *) override;
     void mouseMoveEvent(QMouseEvent *) override;
+    bool event(QEvent *) override;
 
 private:
     void moveButtons();
 
+    void updateTitleFont();
+    void updateTitleLayout();
+    void renderBackground();
+
     MainWindow *m_mainWindow = nullptr;
     Skin *m_skin = nullptr;
     bool m_visible = false;
 
-    QPushButton *m_focusButton = nullptr;
-    QPushButton *m_menuButton = nullptr;
-    QPushButton *m_quitButton = nullptr;
+    SkinButton *m_focusButton = nullptr;
+    SkinButton *m_menuButton = nullptr;
+    SkinButton *m_quitButton = nullptr;
 
     QString m_title;
+
+    QPixmap m_backgroundCache;
+
+    QFont m_titleFont;
+    QStaticText m_titleText;
+    QPoint m_titlePosition;
+    QRect m_titleRect;
 };
 
 #endif
@@ -6,24 +6,24 @@
 
 #include "visualeventoverlay.h"
 #include "browser.h"
+#include "framescheduler.h"
 #include "sessionstack.h"
 #include "settings.h"
 #include "terminal.h"
 
 #include <KColorScheme>
-#include <KStatefulBrush>
 
+#include <QPaintEvent>
 #include <QPainter>
-#include <QTimer>
 
-EventRect::EventRect(const QPoint &topLeft, const QPoint &bottomRight, EventType type, EventFlags flags)
+EventRect::EventRect(const QPoint &topLeft, const QPoint &bottomRight, EventType type, EventFlags flags, qint64 startTime)
     : QRect(topLeft, bottomRight)
 {
     m_eventType = type;
 
     m_eventFlags = flags;
 
-    m_timeStamp.start();
+    m_startTime = startTime;
 }
 
 EventRect::~EventRect() = default;
@@ -45,7 +45,7 @@ bool EventRect::operator<(const EventRect &eventRect) const
         return false;
     if (m_eventType < eventRect.eventType())
         return true;
-    else if (m_timeStamp < eventRect.timeStamp())
+    else if (m_startTime < eventRect.startTime())
         return true;
 
     return false;
@@ -53,6 +53,7 @@ bool EventRect::operator<(const EventRect &eventRect) const
 
 VisualEventOverlay::VisualEventOverlay(SessionStack *parent)
     : QWidget(parent)
+    , m_terminalHighlightBrush(KColorScheme::View, KColorScheme::HoverColor)
 {
     m_sessionStack = parent;
 
@@ -63,11 +64,9 @@ VisualEventOverlay::VisualEventOverlay(SessionStack *parent)
     setFocusPolicy(Qt::NoFocus);
     setAttribute(Qt::WA_TransparentForMouseEvents, true);
 
-    m_cleanupTimer = new QTimer(this);
-    m_cleanupTimer->setSingleShot(true);
-    connect(m_cleanupTimer, SIGNAL(timeout()), this, SLOT(cleanupOverlay()));
+    m_clock.start();
 
-    m_cleanupTimerCeiling = 0;
+    connect(&m_animationTimer, &QTimer::timeout, this, &VisualEventOverlay::advanceAnimation);
 
     hide();
 }
@@ -87,9 +86,6 @@ void VisualEventOverlay::highlightContent(QWidget *contentWidget, bool persisten
         flags |= EventRect::Persistent;
 
     contentEvent(contentWidget, EventRect::TerminalHighlight, flags);
-
-    if (!persistent)
-        scheduleCleanup(Settings::terminalHighlightDuration());
 }
 
 void VisualEventOverlay::removeTerminalHighlight()
@@ -97,17 +93,23 @@ void VisualEventOverlay::removeTerminalHighlight()
     if (!m_eventRects.count())
         return;
 
+    QRegion damage;
+
     QMutableListIterator<EventRect> i(m_eventRects);
 
     while (i.hasNext()) {
-        if (i.next().eventType() == EventRect::TerminalHighlight)
+        const EventRect &eventRect = i.next();
+
+        if (eventRect.eventType() == EventRect::TerminalHighlight) {
+            damage += eventRect;
             i.remove();
+        }
     }
 
-    if (m_sessionStack->requiresVisualEventOverlay())
-        update();
-    else
-        hide();
+    hideIfUnused();
+
+    if (isVisible())
+        FrameScheduler::self()->scheduleUpdate(this, damage);
 }
 
 void VisualEventOverlay::indicateKeyboardInputBlocked(QWidget *contentWidget)
@@ -116,8 +118,6 @@ void VisualEventOverlay::indicateKeyboardInputBlocked(QWidget *contentWidget)
         return;
 
     contentEvent(contentWidget, EventRect::KeyboardInputBlocked);
-
-    scheduleCleanup(Settings::keyboardInputBlockIndicatorDuration());
 }
 
 void VisualEventOverlay::contentEvent(QWidget *contentWidget, EventRect::EventType type, EventRect::EventFlags flags)
@@ -127,58 +127,101 @@ void VisualEventOverlay::contentEvent(QWidget *contentWidget, EventRect::EventTy
     QPoint topLeft(contentWidget->mapTo(parentWidget(), partRect.topLeft()));
     QPoint bottomRight(contentWidget->mapTo(parentWidget(), partRect.bottomRight()));
 
-    EventRect eventRect(topLeft, bottomRight, type, flags);
+    EventRect eventRect(topLeft, bottomRight, type, flags, m_clock.elapsed());
+
+    QRegion damage(eventRect);
+
+    QMutableListIterator<EventRect> i(m_eventRects);
+
+    while (i.hasNext()) {
+        const EventRect &replaced = i.next();
+
+        if (replaced == eventRect) {
+            damage += replaced;
+            i.remove();
+        }
+    }
 
-    m_eventRects.removeAll(eventRect);
-    m_eventRects.append(eventRect);
+    // The list stays sorted, so a new event only has to find its place.
+    m_eventRects.insert(std::upper_bound(m_eventRects.begin(), m_eventRects.end(), eventRect), eventRect);
 
-    std::sort(m_eventRects.begin(), m_eventRects.end());
+    if (!eventRect.testFlag(EventRect::Persistent))
+        startAnimation();
 
-    update();
+    FrameScheduler::self()->scheduleUpdate(this, damage);
 }
 
-void VisualEventOverlay::paintEvent(QPaintEvent *)
+qreal VisualEventOverlay::eventOpacity(const EventRect &eventRect, qint64 now) const
+{
+    qreal opacity;
+    int duration;
+
+    if (eventRect.eventType() == EventRect::TerminalHighlight) {
+        opacity = Settings::terminalHighlightOpacity();
+
+        if (eventRect.testFlag(EventRect::Persistent))
+            return opacity;
+
+        duration = Settings::terminalHighlightDuration();
+    } else {
+        opacity = Settings::keyboardInputBlockIndicatorOpacity();
+        duration = Settings::keyboardInputBlockIndicatorDuration();
+    }
+
+    const qint64 age = now - eventRect.startTime();
+
+    if (duration <= 0 || age >= duration)
+        return 0.0;
+
+    return opacity * (1.0 - qreal(age) / duration);
+}
+
+void VisualEventOverlay::paintEvent(QPaintEvent *event)
 {
     if (!m_eventRects.count())
         return;
 
     QPainter painter(this);
 
-    m_time.start();
-    bool painted = false;
-
-    QListIterator<EventRect> i(m_eventRects);
+    const qint64 now = m_clock.elapsed();
 
-    while (i.hasNext()) {
-        const EventRect &eventRect = i.next();
+    // Exclusive events hide what lies below them, so they are cut out of the
+    // clip as the list is walked.
+    QRegion clip = event->region();
 
-        painted = false;
+    for (const EventRect &eventRect : std::as_const(m_eventRects)) {
+        if (!clip.intersects(eventRect))
+            continue;
 
-        if (eventRect.eventType() == EventRect::TerminalHighlight
-            && (eventRect.timeStamp().msecsTo(m_time) <= Settings::terminalHighlightDuration() || eventRect.testFlag(EventRect::Persistent))) {
-            KStatefulBrush terminalHighlightBrush(KColorScheme::View, KColorScheme::HoverColor);
+        const qreal opacity = eventOpacity(eventRect, now);
 
-            painter.setOpacity(Settings::terminalHighlightOpacity());
+        if (opacity <= 0.0)
+            continue;
 
-            painter.fillRect(eventRect, terminalHighlightBrush.brush(palette()));
-
-            painted = true;
-        } else if (eventRect.eventType() == EventRect::KeyboardInputBlocked
-                   && eventRect.timeStamp().msecsTo(m_time) <= Settings::keyboardInputBlockIndicatorDuration()) {
-            painter.setOpacity(Settings::keyboardInputBlockIndicatorOpacity());
+        painter.setOpacity(opacity);
 
+        if (eventRect.eventType() == EventRect::TerminalHighlight)
+            painter.fillRect(eventRect, m_terminalHighlightBrush.brush(palette()));
+        else
             painter.fillRect(eventRect, Settings::keyboardInputBlockIndicatorColor());
 
-            painted = true;
+        if (eventRect.testFlag(EventRect::Exclusive)) {
+            clip -= eventRect;
+            painter.setClipRegion(clip);
         }
+    }
+}
 
-        if (painted && i.hasNext() && eventRect.testFlag(EventRect::Exclusive)) {
-            if (!painter.hasClipping())
-                painter.setClipRect(rect());
+void VisualEventOverlay::changeEvent(QEvent *event)
+{
+    if (event->type() == QEvent::PaletteChange) {
+        m_terminalHighlightBrush = KStatefulBrush(KColorScheme::View, KColorScheme::HoverColor);
 
-            painter.setClipRegion(painter.clipRegion().subtracted(eventRect));
-        }
+        if (!m_eventRects.isEmpty())
+            FrameScheduler::self()->scheduleUpdate(this);
     }
+
+    QWidget::changeEvent(event);
 }
 
 void VisualEventOverlay::showEvent(QShowEvent *)
@@ -190,45 +233,54 @@ void VisualEventOverlay::showEvent(QShowEvent *)
 
 void VisualEventOverlay::hideEvent(QHideEvent *)
 {
-    m_cleanupTimer->stop();
+    m_animationTimer.stop();
 
     m_eventRects.clear();
 }
 
-void VisualEventOverlay::scheduleCleanup(int in)
+void VisualEventOverlay::startAnimation()
 {
-    int left = (m_cleanupTimerStarted.isValid()) ? m_cleanupTimerCeiling - m_cleanupTimerStarted.elapsed() : 0;
+    if (m_animationTimer.isActive())
+        return;
 
-    if (in > left) {
-        m_cleanupTimerCeiling = in;
-        m_cleanupTimerStarted.start();
-        m_cleanupTimer->start(in);
-    }
+    m_animationTimer.start(FrameScheduler::self()->frameInterval(this));
 }
 
-void VisualEventOverlay::cleanupOverlay()
+void VisualEventOverlay::advanceAnimation()
 {
-    if (m_eventRects.count()) {
-        m_time.start();
+    const qint64 now = m_clock.elapsed();
 
-        QMutableListIterator<EventRect> i(m_eventRects);
+    QRegion damage;
+    bool fading = false;
 
-        while (i.hasNext()) {
-            const EventRect &eventRect = i.next();
+    QMutableListIterator<EventRect> i(m_eventRects);
 
-            if (eventRect.eventType() == EventRect::TerminalHighlight && eventRect.timeStamp().msecsTo(m_time) >= Settings::terminalHighlightDuration()
-                && !eventRect.testFlag(EventRect::Persistent)) {
-                i.remove();
-            } else if (eventRect.eventType() == EventRect::KeyboardInputBlocked
-                       && eventRect.timeStamp().msecsTo(m_time) >= Settings::keyboardInputBlockIndicatorDuration()) {
-                i.remove();
-            }
-        }
+    while (i.hasNext()) {
+        const EventRect &eventRect = i.next();
+
+        if (eventRect.testFlag(EventRect::Persistent))
+            continue;
+
+        damage += eventRect;
+
+        if (eventOpacity(eventRect, now) <= 0.0)
+            i.remove();
+        else
+            fading = true;
     }
 
-    if (m_sessionStack->requiresVisualEventOverlay())
-        update();
-    else
+    if (!fading)
+        m_animationTimer.stop();
+
+    hideIfUnused();
+
+    if (isVisible())
+        FrameScheduler::self()->scheduleUpdate(this, damage);
+}
+
+void VisualEventOverlay::hideIfUnused()
+{
+    if (m_eventRects.isEmpty() && !m_sessionStack->requiresVisualEventOverlay())
         hide();
 }
 
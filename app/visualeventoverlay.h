@@ -7,17 +7,17 @@
 #ifndef VISUALEVENTOVERLAY_H
 #define VISUALEVENTOVERLAY_H
 
+#include <KStatefulBrush>
+
 #include <QElapsedTimer>
 #include <QRect>
-#include <QTime>
+#include <QTimer>
 #include <QWidget>
 
 class SessionStack;
 class Terminal;
 class Browser;
 
-class QTimer;
-
 class EventRect : public QRect
 {
 public:
@@ -34,16 +34,16 @@ public:
     };
     Q_DECLARE_FLAGS(EventFlags, EventFlag)
 
-    EventRect(const QPoint &topLeft, const QPoint &bottomRight, EventType type, EventFlags flags = EventRect::NoFlags);
+    EventRect(const QPoint &topLeft, const QPoint &bottomRight, EventType type, EventFlags flags, qint64 startTime);
     ~EventRect();
 
     EventType eventType() const
     {
         return m_eventType;
     }
-    const QElapsedTimer &timeStamp() const
+    qint64 startTime() const
     {
-        return m_timeStamp;
+        return m_startTime;
     }
 
     EventFlags eventFlags() const
@@ -66,7 +66,7 @@ private:
     EventType m_eventType;
     EventFlags m_eventFlags;
 
-    QElapsedTimer m_timeStamp;
+    qint64 m_startTime;
 };
 
 Q_DECLARE_OPERATORS_FOR_FLAGS(EventRect::EventFlags)
@@ -95,20 +95,24 @@ protected:
     void showEvent(QShowEvent *) override;
     void hideEvent(QHideEvent *) override;
     void paintEvent(QPaintEvent *) override;
+    void changeEvent(QEvent *) override;
 
 private Q_SLOTS:
-    void cleanupOverlay();
+    void advanceAnimation();
 
 private:
-    void scheduleCleanup(int in);
+    qreal eventOpacity(const EventRect &eventRect, qint64 now) const;
+    void startAnimation();
+    void hideIfUnused();
 
     QList<EventRect> m_eventRects;
 
-    QTimer *m_cleanupTimer = nullptr;
-    QElapsedTimer m_cleanupTimerStarted;
-    int m_cleanupTimerCeiling;
+    // Highlights fade out against this clock; the animation timer only runs
+    // while at least one of them is fading.
+    QElapsedTimer m_clock;
+    QTimer m_animationTimer;
 
-    QElapsedTimer m_time;
+    KStatefulBrush m_terminalHighlightBrush;
 
     SessionStack *m_sessionStack = nullptr;
 };
@@ -0,0 +1,146 @@
+/*
+  SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+  SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "controlprotocol.h"
+
+#include <QJsonArray>
+#include <QTest>
+
+class ControlProtocolTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testRoundTrip();
+    void testFrameHeader();
+    void testPartial();
+    void testPipelined();
+    void testOversize();
+    void testMalformed_data();
+    void testMalformed();
+};
+
+static QJsonObject request(int id)
+{
+    return QJsonObject{{QStringLiteral("id"), id},
+                       {QStringLiteral("object"), QStringLiteral("tabs")},
+                       {QStringLiteral("method"), QStringLiteral("tabTitle")},
+                       {QStringLiteral("args"), QJsonArray{id}}};
+}
+
+static QByteArray frame(quint32 size, const QByteArray &payload)
+{
+    QByteArray data(sizeof(quint32), Qt::Uninitialized);
+    qToBigEndian<quint32>(size, data.data());
+
+    return data + payload;
+}
+
+void ControlProtocolTest::testRoundTrip()
+{
+    QByteArray buffer = ControlProtocol::encode(request(1));
+    QList<QJsonObject> messages;
+
+    QVERIFY(ControlProtocol::decode(buffer, messages));
+    QCOMPARE(messages.size(), 1);
+    QCOMPARE(messages.first(), request(1));
+    QVERIFY(buffer.isEmpty());
+}
+
+void ControlProtocolTest::testFrameHeader()
+{
+    const QByteArray encoded = ControlProtocol::encode(request(1));
+    const QByteArray payload = QJsonDocument(request(1)).toJson(QJsonDocument::Compact);
+
+    QCOMPARE(encoded, frame(quint32(payload.size()), payload));
+}
+
+// Bytes arriving one at a time yield the message only once it is complete,
+// and nothing is consumed before that.
+void ControlProtocolTest::testPartial()
+{
+    const QByteArray encoded = ControlProtocol::encode(request(1));
+
+    QByteArray buffer;
+    QList<QJsonObject> messages;
+
+    for (qsizetype i = 0; i < encoded.size() - 1; ++i) {
+        buffer.append(encoded.at(i));
+
+        QVERIFY(ControlProtocol::decode(buffer, messages));
+        QVERIFY(messages.isEmpty());
+        QCOMPARE(buffer.size(), i + 1);
+    }
+
+    buffer.append(encoded.back());
+
+    QVERIFY(ControlProtocol::decode(buffer, messages));
+    QCOMPARE(messages.size(), 1);
+    QCOMPARE(messages.first(), request(1));
+    QVERIFY(buffer.isEmpty());
+}
+
+// Complete messages are taken in order; a trailing partial one stays in the
+// buffer for the next read.
+void ControlProtocolTest::testPipelined()
+{
+    const QByteArray third = ControlProtocol::encode(request(3));
+
+    QByteArray buffer = ControlProtocol::encode(request(1)) + ControlProtocol::encode(request(2)) + third.left(third.size() / 2);
+    QList<QJsonObject> messages;
+
+    QVERIFY(ControlProtocol::decode(buffer, messages));
+    QCOMPARE(messages.size(), 2);
+    QCOMPARE(messages.at(0), request(1));
+    QCOMPARE(messages.at(1), request(2));
+    QCOMPARE(buffer, third.left(third.size() / 2));
+
+    buffer.append(third.mid(third.size() / 2));
+
+    QVERIFY(ControlProtocol::decode(buffer, messages));
+    QCOMPARE(messages.size(), 3);
+    QCOMPARE(messages.at(2), request(3));
+    QVERIFY(buffer.isEmpty());
+}
+
+// An oversized length is rejected from the header alone, without waiting
+// for the payload.
+void ControlProtocolTest::testOversize()
+{
+    QByteArray buffer = frame(ControlProtocol::MaxMessageSize + 1, QByteArray());
+    QList<QJsonObject> messages;
+
+    QVERIFY(!ControlProtocol::decode(buffer, messages));
+
+    buffer = frame(ControlProtocol::MaxMessageSize, QByteArray("{"));
+
+    QVERIFY(ControlProtocol::decode(buffer, messages));
+    QVERIFY(messages.isEmpty());
+}
+
+void ControlProtocolTest::testMalformed_data()
+{
+    QTest::addColumn<QByteArray>("payload");
+
+    QTest::newRow("not json") << QByteArray("hello");
+    QTest::newRow("truncated json") << QByteArray(R"({"id": 1)");
+    QTest::newRow("array") << QByteArray("[1, 2]");
+    QTest::newRow("empty") << QByteArray();
+}
+
+void ControlProtocolTest::testMalformed()
+{
+    QFETCH(QByteArray, payload);
+
+    QByteArray buffer = ControlProtocol::encode(request(1)) + frame(quint32(payload.size()), payload);
+    QList<QJsonObject> messages;
+
+    QVERIFY(!ControlProtocol::decode(buffer, messages));
+}
+
+QTEST_GUILESS_MAIN(ControlProtocolTest)
+
+#include "controlprotocoltest.moc"
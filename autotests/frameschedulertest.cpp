@@ -0,0 +1,77 @@
+/*
+  SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+  SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "framescheduler.h"
+
+#include <QTest>
+#include <QWidget>
+
+class FrameSchedulerTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testMerge();
+    void testSeparateWidgets();
+    void testEmptyRegion();
+};
+
+// A burst of requests for one widget is delivered as a single update.
+void FrameSchedulerTest::testMerge()
+{
+    FrameScheduler *scheduler = FrameScheduler::self();
+    QWidget widget;
+    widget.resize(100, 100);
+
+    const quint64 requested = scheduler->requestedUpdates();
+    const quint64 delivered = scheduler->deliveredUpdates();
+    const quint64 merged = scheduler->mergedUpdates();
+
+    scheduler->scheduleUpdate(&widget);
+    scheduler->scheduleUpdate(&widget, QRect(0, 0, 10, 10));
+    scheduler->scheduleUpdate(&widget, QRect(50, 50, 10, 10));
+
+    QCOMPARE(scheduler->requestedUpdates() - requested, quint64(3));
+
+    QTRY_COMPARE(scheduler->deliveredUpdates() - delivered, quint64(1));
+    QCOMPARE(scheduler->mergedUpdates() - merged, quint64(2));
+}
+
+void FrameSchedulerTest::testSeparateWidgets()
+{
+    FrameScheduler *scheduler = FrameScheduler::self();
+    QWidget first;
+    QWidget second;
+    first.resize(100, 100);
+    second.resize(100, 100);
+
+    const quint64 delivered = scheduler->deliveredUpdates();
+    const quint64 merged = scheduler->mergedUpdates();
+
+    scheduler->scheduleUpdate(&first);
+    scheduler->scheduleUpdate(&second);
+    scheduler->scheduleUpdate(&first);
+
+    QTRY_COMPARE(scheduler->deliveredUpdates() - delivered, quint64(2));
+    QCOMPARE(scheduler->mergedUpdates() - merged, quint64(1));
+}
+
+void FrameSchedulerTest::testEmptyRegion()
+{
+    FrameScheduler *scheduler = FrameScheduler::self();
+    QWidget widget;
+
+    const quint64 requested = scheduler->requestedUpdates();
+
+    scheduler->scheduleUpdate(&widget, QRegion());
+    scheduler->scheduleUpdate(nullptr, QRect(0, 0, 10, 10));
+
+    QCOMPARE(scheduler->requestedUpdates(), requested);
+}
+
+QTEST_MAIN(FrameSchedulerTest)
+
+#include "frameschedulertest.moc"
@@ -0,0 +1,79 @@
+/*
+  SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+  SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "sessionids.h"
+
+#include <QTest>
+
+class SessionIdsTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testParse_data();
+    void testParse();
+    void testIsPermutation_data();
+    void testIsPermutation();
+};
+
+void SessionIdsTest::testParse_data()
+{
+    QTest::addColumn<QString>("idList");
+    QTest::addColumn<bool>("valid");
+    QTest::addColumn<QList<int>>("ids");
+
+    QTest::newRow("empty") << QString() << true << QList<int>();
+    QTest::newRow("single") << QStringLiteral("4") << true << QList<int>{4};
+    QTest::newRow("ordered as given") << QStringLiteral("3,1,2") << true << QList<int>{3, 1, 2};
+    QTest::newRow("whitespace") << QStringLiteral(" 3 , 1,\t2 ") << true << QList<int>{3, 1, 2};
+    QTest::newRow("empty entries") << QStringLiteral(",3,,1,") << true << QList<int>{3, 1};
+    QTest::newRow("duplicates kept") << QStringLiteral("1,1") << true << QList<int>{1, 1};
+    QTest::newRow("not a number") << QStringLiteral("1,two") << false << QList<int>();
+    QTest::newRow("blank entry") << QStringLiteral("1, ,2") << false << QList<int>();
+    QTest::newRow("trailing garbage") << QStringLiteral("1,2x") << false << QList<int>();
+}
+
+void SessionIdsTest::testParse()
+{
+    QFETCH(QString, idList);
+    QFETCH(bool, valid);
+    QFETCH(QList<int>, ids);
+
+    QList<int> parsed;
+
+    QCOMPARE(SessionIds::parse(idList, parsed), valid);
+
+    if (valid)
+        QCOMPARE(parsed, ids);
+}
+
+void SessionIdsTest::testIsPermutation_data()
+{
+    QTest::addColumn<QList<int>>("order");
+    QTest::addColumn<QList<int>>("current");
+    QTest::addColumn<bool>("permutation");
+
+    QTest::newRow("same") << QList<int>{0, 1, 2} << QList<int>{0, 1, 2} << true;
+    QTest::newRow("reordered") << QList<int>{2, 0, 1} << QList<int>{0, 1, 2} << true;
+    QTest::newRow("both empty") << QList<int>() << QList<int>() << true;
+    QTest::newRow("missing") << QList<int>{2, 0} << QList<int>{0, 1, 2} << false;
+    QTest::newRow("extra") << QList<int>{2, 0, 1, 3} << QList<int>{0, 1, 2} << false;
+    QTest::newRow("unknown") << QList<int>{2, 0, 5} << QList<int>{0, 1, 2} << false;
+    QTest::newRow("duplicate") << QList<int>{2, 2, 1} << QList<int>{0, 1, 2} << false;
+}
+
+void SessionIdsTest::testIsPermutation()
+{
+    QFETCH(QList<int>, order);
+    QFETCH(QList<int>, current);
+    QFETCH(bool, permutation);
+
+    QCOMPARE(SessionIds::isPermutation(order, current), permutation);
+}
+
+QTEST_GUILESS_MAIN(SessionIdsTest)
+
+#include "sessionidstest.moc"
@@ -0,0 +1,166 @@
+/*
+  SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+  SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "sessionlayout.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QTest>
+
+class SessionLayoutTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testTerminal();
+    void testSplitter();
+    void testSizes_data();
+    void testSizes();
+    void testInvalid_data();
+    void testInvalid();
+    void testMaxDepth();
+    void testMaxTerminals();
+    void testCommands();
+};
+
+static QJsonObject json(const char *text)
+{
+    return QJsonDocument::fromJson(QByteArray(text)).object();
+}
+
+// Nests a single terminal depth levels deep, counting the terminal.
+static QJsonObject nested(int depth)
+{
+    QJsonObject node{{QStringLiteral("cwd"), QStringLiteral("/tmp")}};
+
+    for (int i = 1; i < depth; ++i)
+        node = QJsonObject{{QStringLiteral("children"), QJsonArray{node}}};
+
+    return node;
+}
+
+static QJsonObject row(int terminals)
+{
+    QJsonArray children;
+
+    for (int i = 0; i < terminals; ++i)
+        children << QJsonObject{{QStringLiteral("profile"), QStringLiteral("Shell")}};
+
+    return QJsonObject{{QStringLiteral("children"), children}};
+}
+
+void SessionLayoutTest::testTerminal()
+{
+    SessionLayout::Spec spec;
+
+    QVERIFY(SessionLayout::parse(json(R"({"cwd": "/tmp", "profile": "Shell"})"), spec, false));
+    QVERIFY(spec.title.isEmpty());
+    QVERIFY(spec.root.isTerminal());
+    QCOMPARE(spec.root.cwd, QStringLiteral("/tmp"));
+    QCOMPARE(spec.root.profile, QStringLiteral("Shell"));
+    QCOMPARE(SessionLayout::terminalCount(spec.root), 1);
+}
+
+void SessionLayoutTest::testSplitter()
+{
+    SessionLayout::Spec spec;
+
+    QVERIFY(SessionLayout::parse(json(R"({"title": "Work", "layout": {"orientation": "vertical", "children": [
+                                          {"cwd": "/a"},
+                                          {"children": [{"cwd": "/b"}, {"cwd": "/c"}]}]}})"),
+                                 spec,
+                                 false));
+
+    QCOMPARE(spec.title, QStringLiteral("Work"));
+    QVERIFY(!spec.root.isTerminal());
+    QCOMPARE(spec.root.orientation, Qt::Vertical);
+    QCOMPARE(spec.root.children.size(), size_t(2));
+    QCOMPARE(spec.root.children[0].cwd, QStringLiteral("/a"));
+    QCOMPARE(spec.root.children[1].orientation, Qt::Horizontal);
+    QCOMPARE(spec.root.children[1].children[1].cwd, QStringLiteral("/c"));
+    QCOMPARE(SessionLayout::terminalCount(spec.root), 3);
+}
+
+void SessionLayoutTest::testSizes_data()
+{
+    QTest::addColumn<QByteArray>("layout");
+    QTest::addColumn<QList<int>>("sizes");
+
+    QTest::newRow("ratios") << QByteArray(R"({"sizes": [1, 3], "children": [{}, {}]})") << QList<int>{250, 750};
+    QTest::newRow("percentages") << QByteArray(R"({"sizes": [60, 40], "children": [{}, {}]})") << QList<int>{600, 400};
+    QTest::newRow("missing") << QByteArray(R"({"children": [{}, {}, {}]})") << QList<int>{333, 333, 333};
+    QTest::newRow("count mismatch") << QByteArray(R"({"sizes": [1], "children": [{}, {}]})") << QList<int>{500, 500};
+    QTest::newRow("all zero") << QByteArray(R"({"sizes": [0, 0], "children": [{}, {}]})") << QList<int>{500, 500};
+    QTest::newRow("negative") << QByteArray(R"({"sizes": [-1, 1], "children": [{}, {}]})") << QList<int>{0, 1000};
+}
+
+void SessionLayoutTest::testSizes()
+{
+    QFETCH(QByteArray, layout);
+    QFETCH(QList<int>, sizes);
+
+    SessionLayout::Spec spec;
+
+    QVERIFY(SessionLayout::parse(QJsonDocument::fromJson(layout).object(), spec, false));
+    QCOMPARE(spec.root.sizes, sizes);
+}
+
+void SessionLayoutTest::testInvalid_data()
+{
+    QTest::addColumn<QByteArray>("layout");
+
+    QTest::newRow("empty") << QByteArray("{}");
+    QTest::newRow("layout not an object") << QByteArray(R"({"layout": [{}]})");
+    QTest::newRow("child not an object") << QByteArray(R"({"children": [{}, "terminal"]})");
+    QTest::newRow("nested child not an object") << QByteArray(R"({"children": [{"children": [{}, 1]}]})");
+}
+
+void SessionLayoutTest::testInvalid()
+{
+    QFETCH(QByteArray, layout);
+
+    SessionLayout::Spec spec;
+
+    QVERIFY(!SessionLayout::parse(QJsonDocument::fromJson(layout).object(), spec, true));
+}
+
+void SessionLayoutTest::testMaxDepth()
+{
+    SessionLayout::Spec spec;
+
+    QVERIFY(SessionLayout::parse(nested(SessionLayout::MaxDepth), spec, false));
+    QVERIFY(!SessionLayout::parse(nested(SessionLayout::MaxDepth + 1), spec, false));
+}
+
+void SessionLayoutTest::testMaxTerminals()
+{
+    SessionLayout::Spec spec;
+
+    QVERIFY(SessionLayout::parse(row(SessionLayout::MaxTerminals), spec, false));
+    QCOMPARE(SessionLayout::terminalCount(spec.root), SessionLayout::MaxTerminals);
+
+    QVERIFY(!SessionLayout::parse(row(SessionLayout::MaxTerminals + 1), spec, false));
+}
+
+void SessionLayoutTest::testCommands()
+{
+    const QJsonObject layout = json(R"({"children": [{"cwd": "/a"}, {"command": "make"}]})");
+
+    SessionLayout::Spec spec;
+
+    QVERIFY(!SessionLayout::parse(layout, spec, false));
+
+    QVERIFY(SessionLayout::parse(layout, spec, true));
+    QVERIFY(SessionLayout::hasCommands(spec.root));
+    QCOMPARE(spec.root.children[1].command, QStringLiteral("make"));
+
+    QVERIFY(SessionLayout::parse(json(R"({"children": [{"cwd": "/a"}, {"cwd": "/b"}]})"), spec, true));
+    QVERIFY(!SessionLayout::hasCommands(spec.root));
+}
+
+QTEST_GUILESS_MAIN(SessionLayoutTest)
+
+#include "sessionlayouttest.moc"
@@ -0,0 +1,58 @@
+# SPDX-FileCopyrightText: 2026 agent <agent@local>
+#
+# SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+
+# Turns the descriptors of the compiled-in skin into tables of
+# (group, key, value) entries, so that the skin needs no config parsing at
+# runtime. Invoked with -DTITLE_SKIN=... -DTABS_SKIN=... -DOUTPUT=... -P.
+
+function(read_skin_entries file out_var)
+    file(STRINGS "${file}" lines ENCODING UTF-8)
+
+    set(group "")
+    set(entries "")
+
+    foreach(line IN LISTS lines)
+        string(STRIP "${line}" line)
+
+        if(line MATCHES "^\\[(.+)\\]$")
+            set(group "${CMAKE_MATCH_1}")
+        elseif(line MATCHES "^([^=#]+)=(.*)$")
+            string(STRIP "${CMAKE_MATCH_1}" key)
+            string(STRIP "${CMAKE_MATCH_2}" value)
+            string(REPLACE "\\" "\\\\" value "${value}")
+            string(REPLACE "\"" "\\\"" value "${value}")
+            string(APPEND entries "    {\"${group}\", \"${key}\", \"${value}\"},\n")
+        endif()
+    endforeach()
+
+    set(${out_var} "${entries}" PARENT_SCOPE)
+endfunction()
+
+read_skin_entries("${TITLE_SKIN}" title_entries)
+read_skin_entries("${TABS_SKIN}" tabs_entries)
+
+set(content "// Generated from title.skin and tabs.skin by GenerateSkinMetrics.cmake, do not edit.
+
+#ifndef DEFAULTSKINMETRICS_H
+#define DEFAULTSKINMETRICS_H
+
+struct SkinMetricsEntry {
+    const char *group;
+    const char *key;
+    const char *value;
+};
+
+static const SkinMetricsEntry defaultSkinTitleMetrics[] = {
+${title_entries}};
+
+static const SkinMetricsEntry defaultSkinTabsMetrics[] = {
+${tabs_entries}};
+
+#endif
+")
+
+# Only touch the header when it changed, to not rebuild skin.cpp needlessly.
+file(WRITE "${OUTPUT}.tmp" "${content}")
+configure_file("${OUTPUT}.tmp" "${OUTPUT}" COPYONLY)
+file(REMOVE "${OUTPUT}.tmp")
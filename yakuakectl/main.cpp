@@ -0,0 +1,311 @@
+/*
+  SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+  SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "controlprotocol.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QLocalSocket>
+#include <QTextStream>
+
+static const int Timeout = 30000;
+
+static QTextStream &out()
+{
+    static QTextStream stream(stdout);
+    return stream;
+}
+
+static QTextStream &err()
+{
+    static QTextStream stream(stderr);
+    return stream;
+}
+
+static void printUsage()
+{
+    out() << "Usage: yakuakectl [--json] <command> [-- <command>...]\n"
+             "\n"
+             "Controls Yakuake through its control socket, which has to be enabled in\n"
+             "its settings. Several commands separated by -- are sent as one batch.\n"
+             "\n"
+             "Commands:\n"
+             "  list                          List the sessions and their terminals\n"
+             "  new [layout]                  Open a session, optionally from a layout file\n"
+             "                                or JSON string, and print its terminal ids\n"
+             "  split <id> [horizontal|vertical]\n"
+             "                                Split the terminal <id> and print the new id\n"
+             "  title <session id> <title>    Set the title of a tab\n"
+             "  send <targets> <command>      Run a command in terminals; targets are\n"
+             "                                \"all\", \"session:<id>\" or a list of ids\n"
+             "  wait [event]                  Wait for a change event and print it\n"
+             "  call <object> <method> [args...]\n"
+             "                                Call any scriptable method of \"window\",\n"
+             "                                \"tabs\" or \"sessions\"\n";
+    out().flush();
+}
+
+static QJsonObject request(const QString &object, const QString &method, const QStringList &args)
+{
+    QJsonObject message;
+    message[QLatin1String("object")] = object;
+    message[QLatin1String("method")] = method;
+    message[QLatin1String("args")] = QJsonArray::fromStringList(args);
+
+    return message;
+}
+
+// Turns one command line into a request, or returns an empty object.
+static QJsonObject parseCommand(const QStringList &command, QString &error)
+{
+    const QString name = command.value(0);
+    const QStringList args = command.mid(1);
+
+    if (name == QLatin1String("list") && args.isEmpty())
+        return request(QStringLiteral("sessions"), QStringLiteral("sessionTree"), {});
+
+    if (name == QLatin1String("new") && args.size() <= 1) {
+        QString layout;
+
+        if (args.isEmpty()) {
+            QJsonObject terminal;
+            terminal[QLatin1String("cwd")] = QDir::currentPath();
+
+            layout = QString::fromUtf8(QJsonDocument(terminal).toJson(QJsonDocument::Compact));
+        } else if (QFile::exists(args.first())) {
+            QFile file(args.first());
+
+            if (!file.open(QIODevice::ReadOnly)) {
+                error = QStringLiteral("cannot read %1").arg(args.first());
+                return QJsonObject();
+            }
+
+            layout = QString::fromUtf8(file.readAll());
+        } else {
+            layout = args.first();
+        }
+
+        return request(QStringLiteral("sessions"), QStringLiteral("addSessionFromLayout"), {layout});
+    }
+
+    if (name == QLatin1String("split") && (args.size() == 1 || args.size() == 2)) {
+        const bool vertical = args.value(1) == QLatin1String("vertical");
+
+        return request(QStringLiteral("sessions"), vertical ? QStringLiteral("splitContentTopBottom") : QStringLiteral("splitContentLeftRight"), {args.first()});
+    }
+
+    if (name == QLatin1String("title") && args.size() == 2)
+        return request(QStringLiteral("tabs"), QStringLiteral("setTabTitle"), args);
+
+    if (name == QLatin1String("send") && args.size() == 2)
+        return request(QStringLiteral("sessions"), QStringLiteral("runCommandInContents"), args);
+
+    if (name == QLatin1String("call") && args.size() >= 2)
+        return request(args.at(0), args.at(1), args.mid(2));
+
+    error = QStringLiteral("invalid command: %1").arg(command.join(QLatin1Char(' ')));
+
+    return QJsonObject();
+}
+
+static void printSessionTree(const QJsonObject &tree)
+{
+    const QJsonArray sessions = tree.value(QLatin1String("sessions")).toArray();
+    const int activeSessionId = tree.value(QLatin1String("activeSessionId")).toInt(-1);
+
+    for (const QJsonValue &value : sessions) {
+        const QJsonObject session = value.toObject();
+        const int sessionId = session.value(QLatin1String("id")).toInt();
+
+        out() << (sessionId == activeSessionId ? "* " : "  ") << sessionId << '\t' << session.value(QLatin1String("tabTitle")).toString() << '\n';
+
+        QList<QJsonObject> nodes = {session.value(QLatin1String("layout")).toObject()};
+
+        while (!nodes.isEmpty()) {
+            const QJsonObject node = nodes.takeFirst();
+            const QJsonArray children = node.value(QLatin1String("children")).toArray();
+
+            if (children.isEmpty()) {
+                out() << "    " << node.value(QLatin1String("id")).toInt() << '\t' << node.value(QLatin1String("type")).toString() << '\t'
+                      << node.value(QLatin1String("cwd")).toString(node.value(QLatin1String("url")).toString()) << '\n';
+                continue;
+            }
+
+            QList<QJsonObject> childNodes;
+
+            for (const QJsonValue &child : children)
+                childNodes.append(child.toObject());
+
+            nodes = childNodes + nodes;
+        }
+    }
+}
+
+static void printResult(const QJsonValue &result, const QString &method, bool json)
+{
+    if (json) {
+        out() << QJsonDocument(QJsonArray{result}).toJson(QJsonDocument::Compact).mid(1).chopped(1) << '\n';
+        return;
+    }
+
+    if (method == QLatin1String("sessionTree")) {
+        printSessionTree(QJsonDocument::fromJson(result.toString().toUtf8()).object());
+    } else if (result.isArray()) {
+        const QJsonArray values = result.toArray();
+
+        for (const QJsonValue &value : values)
+            out() << value.toVariant().toString() << '\n';
+    } else if (!result.isNull() && !result.isUndefined()) {
+        out() << result.toVariant().toString() << '\n';
+    }
+}
+
+static bool readMessage(QLocalSocket &socket, QByteArray &buffer, QList<QJsonObject> &messages, int timeout)
+{
+    while (messages.isEmpty()) {
+        if (!ControlProtocol::decode(buffer, messages)) {
+            err() << "yakuakectl: malformed reply\n";
+            return false;
+        }
+
+        if (!messages.isEmpty())
+            break;
+
+        if (!socket.waitForReadyRead(timeout)) {
+            err() << "yakuakectl: " << socket.errorString() << '\n';
+            return false;
+        }
+
+        buffer.append(socket.readAll());
+    }
+
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QStringList arguments = app.arguments().mid(1);
+    bool json = false;
+
+    if (arguments.value(0) == QLatin1String("--json")) {
+        json = true;
+        arguments.removeFirst();
+    }
+
+    if (arguments.isEmpty() || arguments.first() == QLatin1String("--help") || arguments.first() == QLatin1String("-h")) {
+        printUsage();
+        return arguments.isEmpty() ? 1 : 0;
+    }
+
+    // Split the arguments into commands; a wait may only end the batch.
+    QList<QJsonObject> requests;
+    QString waitEvent;
+    bool wait = false;
+
+    QList<QStringList> commands = {QStringList()};
+
+    for (const QString &argument : std::as_const(arguments)) {
+        if (argument == QLatin1String("--"))
+            commands.append(QStringList());
+        else
+            commands.last().append(argument);
+    }
+
+    for (int i = 0; i < commands.size(); ++i) {
+        const QStringList &command = commands.at(i);
+
+        if (command.value(0) == QLatin1String("wait") && command.size() <= 2 && i == commands.size() - 1) {
+            wait = true;
+            waitEvent = command.value(1);
+
+            QJsonObject subscribe;
+            subscribe[QLatin1String("method")] = QStringLiteral("subscribe");
+            requests.append(subscribe);
+
+            continue;
+        }
+
+        QString error;
+        const QJsonObject request = parseCommand(command, error);
+
+        if (request.isEmpty()) {
+            err() << "yakuakectl: " << error << '\n';
+            return 1;
+        }
+
+        requests.append(request);
+    }
+
+    QLocalSocket socket;
+    socket.connectToServer(ControlProtocol::socketPath());
+
+    if (!socket.waitForConnected(Timeout)) {
+        err() << "yakuakectl: cannot connect to Yakuake, is its control socket enabled? (" << socket.errorString() << ")\n";
+        return 1;
+    }
+
+    // The whole batch goes out in one write and is answered in order.
+    QByteArray batch;
+
+    for (int i = 0; i < requests.size(); ++i) {
+        requests[i][QLatin1String("id")] = i;
+        batch.append(ControlProtocol::encode(requests.at(i)));
+    }
+
+    socket.write(batch);
+
+    QByteArray buffer;
+    QList<QJsonObject> messages;
+    int exitCode = 0;
+
+    for (const QJsonObject &sent : std::as_const(requests)) {
+        if (!readMessage(socket, buffer, messages, Timeout))
+            return 1;
+
+        const QJsonObject reply = messages.takeFirst();
+
+        if (reply.contains(QLatin1String("error"))) {
+            err() << "yakuakectl: " << sent.value(QLatin1String("method")).toString() << ": " << reply.value(QLatin1String("error")).toString() << '\n';
+            exitCode = 1;
+        } else if (sent.value(QLatin1String("method")) != QLatin1String("subscribe")) {
+            printResult(reply.value(QLatin1String("result")), sent.value(QLatin1String("method")).toString(), json);
+        }
+    }
+
+    while (wait) {
+        if (!readMessage(socket, buffer, messages, -1))
+            return 1;
+
+        const QJsonObject event = messages.takeFirst();
+        const QString name = event.value(QLatin1String("event")).toString();
+
+        if (name.isEmpty() || (!waitEvent.isEmpty() && name != waitEvent))
+            continue;
+
+        if (json) {
+            out() << QJsonDocument(event).toJson(QJsonDocument::Compact) << '\n';
+        } else {
+            out() << name;
+
+            const QJsonArray values = event.value(QLatin1String("args")).toArray();
+
+            for (const QJsonValue &value : values)
+                out() << '\t' << value.toVariant().toString();
+
+            out() << '\n';
+        }
+
+        wait = false;
+    }
+
+    out().flush();
+
+    return exitCode;
+}